@@ -0,0 +1,114 @@
+/*
+* command_scheduler.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+
+#ifndef COMMAND_SCHEDULER_H
+#define COMMAND_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "swarm_planner.h"
+
+namespace common
+{
+    struct scheduler_parameters
+    {
+        // a command closer than these to the last one sent is not sent
+        double velocity_deadband;
+        double height_deadband;
+        // the last command is sent again after this long, 0 sends every
+        // command, at most max_silence
+        double keep_alive;
+        // commands a second on one radio, 0 does not limit them
+        double radio_rate;
+        // commands one radio can send at once after being idle
+        double radio_burst;
+    };
+
+    /**
+     * @brief decides which velocity commands go out. A command is due when
+     * it moved out of the deadband of the last one sent to its agent or the
+     * keep alive ran out. Every radio has a token bucket, when the due
+     * commands are over it the most urgent go first and the rest wait for a
+     * later call, the wait adds to their urgency so none starves. An agent
+     * never sent a command, or not for max_silence or the shorter keep alive,
+     * gets one whatever the budget and the radio owes the token. Not thread
+     * safe.
+    **/
+    class command_scheduler
+    {
+        public:
+
+            /** @brief half the 0.5s the crazyflie streams a setpoint without a new one **/
+            static constexpr double max_silence = 0.25;
+
+            explicit command_scheduler(const scheduler_parameters &parameters);
+
+            /** @brief adds an agent on the radio, the returned index is used by the commands **/
+            size_t add_agent(size_t radio);
+
+            /** 
+             * @brief keep the commands to send now, urgency is given per
+             * command and is added to the time the agent waited
+            **/
+            void schedule(std::vector<velocity_command> &commands, 
+                const std::vector<double> &urgency, double now);
+
+            /** @brief the next command of the agent is due at once **/
+            void reset(size_t index) { last[index].sent = false; }
+
+            /** @brief commands left out as in the deadband, and for the budget **/
+            uint64_t suppressed() const { return suppressed_count; }
+            uint64_t deferred() const { return deferred_count; }
+
+        private:
+
+            struct last_command
+            {
+                bool sent = false;
+                Eigen::Vector3d velocity;
+                double height;
+                double time;
+            };
+
+            scheduler_parameters param;
+
+            std::vector<size_t> radios;
+            std::vector<last_command> last;
+
+            std::vector<double> tokens;
+            double last_refill;
+            bool refilled = false;
+
+            // reused between the calls, urgency and position of the due commands
+            std::vector<std::pair<double, size_t>> due;
+            std::vector<uint8_t> keep;
+
+            uint64_t suppressed_count = 0;
+            uint64_t deferred_count = 0;
+
+            void refill(double now);
+    };
+}
+
+#endif
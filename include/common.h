@@ -24,7 +24,9 @@
 #include <regex>
 #include <mutex>
 #include <queue>
+#include <deque>
 #include <string>
+#include <unordered_map>
 
 #include <Eigen/Dense>
 #include <rclcpp/rclcpp.hpp>
@@ -32,15 +34,24 @@
 #include "crazyflie_interfaces/srv/land.hpp"
 #include "crazyflie_interfaces/srv/go_to.hpp"
 #include "crazyflie_interfaces/srv/set_group_mask.hpp"
+#include "crazyflie_interfaces/srv/upload_trajectory.hpp"
+#include "crazyflie_interfaces/srv/start_trajectory.hpp"
+#include "crazyflie_interfaces/srv/notify_setpoints_stop.hpp"
 #include "crazyflie_interfaces/msg/velocity_world.hpp"
 
 #include <gtsam/geometry/Pose3.h>
 
 #include <Eigen/SVD>
 
+#include "seqlock.h"
+#include "spsc_ring.h"
+
 using crazyflie_interfaces::srv::Land;
 using crazyflie_interfaces::srv::GoTo;
 using crazyflie_interfaces::srv::SetGroupMask;
+using crazyflie_interfaces::srv::UploadTrajectory;
+using crazyflie_interfaces::srv::StartTrajectory;
+using crazyflie_interfaces::srv::NotifySetpointsStop;
 using crazyflie_interfaces::msg::VelocityWorld;
 
 namespace common
@@ -50,6 +61,9 @@ namespace common
         rclcpp::Client<SetGroupMask>::SharedPtr set_group;
         rclcpp::Client<GoTo>::SharedPtr go_to;
         rclcpp::Client<Land>::SharedPtr land;
+        rclcpp::Client<UploadTrajectory>::SharedPtr upload_trajectory;
+        rclcpp::Client<StartTrajectory>::SharedPtr start_trajectory;
+        rclcpp::Client<NotifySetpointsStop>::SharedPtr notify_setpoints_stop;
         rclcpp::Publisher<VelocityWorld>::SharedPtr vel_world_publisher;
     };
 
@@ -81,10 +95,78 @@ namespace common
         }
     };
 
+    /** @brief raw pose written by the pose callback, orientation is w,x,y,z **/
+    struct pose_sample
+    {
+        int64_t stamp;
+        double position[3];
+        double orientation[4];
+        // numbered per agent from 1 on ingestion, with the steady clock
+        // time it was ingested, to trace the commands planned from it
+        uint64_t sequence;
+        int64_t received;
+    };
+
+    struct twist_sample
+    {
+        double linear[3];
+    };
+
+    /**
+     * @brief dense store of the swarm, agent i owns the i-th element of
+     * every array, the agents are added once from the robots parameters.
+     * Callbacks write into the per agent seqlocks and snapshot() copies the
+     * latest samples into the arrays, hence the arrays only change on the
+     * thread that takes the snapshot
+    **/
+    struct swarm_registry
+    {
+        std::vector<std::string> names;
+        // numeric part of cfXX, parsed once when the agent is added
+        std::vector<int> ids;
+        std::vector<rclcpp::Time> t;
+        // sequence and steady clock ingestion time of the snapshot pose
+        std::vector<uint64_t> sequence;
+        std::vector<int64_t> received;
+        std::vector<Eigen::Vector3d> position;
+        std::vector<Eigen::Quaterniond> orientation;
+        std::vector<Eigen::Vector3d> velocity;
+        std::vector<std::queue<Eigen::Vector3d>> target_queue;
+        std::vector<double> target_yaw;
+        std::vector<Eigen::Vector3d> previous_target;
+        std::vector<size_t> flight_state;
+        std::vector<uint8_t> radio_connection;
+        std::vector<uint8_t> completed;
+        std::vector<uint8_t> mission_capable;
+
+        // name lookup, for user commands and the named pose array
+        std::unordered_map<std::string, size_t> lookup;
+
+        // written by the pose and twist callbacks without taking a lock
+        std::deque<seqlock<pose_sample>> pose_buffer;
+        std::deque<seqlock<twist_sample>> twist_buffer;
+
+        size_t size() const {return names.size();}
+
+        size_t add(const std::string &name, const Eigen::Vector3d &initial_position,
+            bool is_mission_capable, const rclcpp::Time &now);
+
+        /** @brief returns false if the name is not in the swarm **/
+        bool find(const std::string &name, size_t &index) const;
+
+        Eigen::Affine3d transform(size_t index) const;
+
+        /** @brief pose from the latest sample instead of the snapshot **/
+        Eigen::Affine3d latest_transform(size_t index) const;
+
+        /** @brief copy the latest samples into the arrays **/
+        void snapshot();
+    };
+
     struct tag
     {
         rclcpp::Time t;
-        uint8_t id;
+        int32_t id;
         Eigen::Affine3d transform;
         Eigen::Vector2i pixel_center;
         std::string type;
@@ -104,12 +186,19 @@ namespace common
         }
     };
 
-    struct tag_queue
+    /** @brief tag as it is passed through the tag rings, orientation is w,x,y,z **/
+    struct tag_sample
     {
-        std::queue<tag> t_queue;
-        std::queue<agent_state> s_queue;
+        int64_t stamp;
+        int32_t id;
+        int32_t pixel_center[2];
+        double position[3];
+        double orientation[4];
     };
 
+    // written by the tag callback and drained by the tag timer
+    typedef spsc_ring<tag_sample> tag_queue;
+
     struct observation
     {
         gtsam::Pose3 pose;
@@ -121,6 +210,18 @@ namespace common
         std::map<long, observation> observations;
     };
 
+    /** 
+     * @brief obstacle from environment.obstacles in the config, a
+     * "wall-disjointed" obstacle is an open polyline of vertical walls that
+     * span the height range
+    **/
+    struct obstacle
+    {
+        std::string type;
+        std::pair<double, double> height;
+        std::vector<Eigen::Vector2d> points;
+    };
+
     enum fsm
     {
         IDLE, // Have not taken off
@@ -153,10 +254,16 @@ namespace common
     const std::string relocalize = "relocalization";
     const std::string eliminate = "eliminate";
 
+    const std::string wall_disjointed = "wall-disjointed";
+
     std::set<std::string> extract_names(
         const std::map<std::string, rclcpp::ParameterValue> &parameter_overrides,
         const std::string &pattern);
 
+    /** @brief reads every obstacle under environment.obstacles **/
+    std::map<std::string, obstacle> load_obstacles(
+        const std::map<std::string, rclcpp::ParameterValue> &parameter_overrides);
+
     /** 
      * @brief similar to the ROS euler rpy which does not require the tf library, 
      * hence independent of ROS but yield the same rotation 
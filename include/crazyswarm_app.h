@@ -17,11 +17,18 @@
 */
 
 #include <memory>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <algorithm>
 #include <vector>
 #include <regex>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 
 #include <Eigen/Dense>
 
@@ -49,13 +56,27 @@
 #include "visualization_msgs/msg/marker_array.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
+#include "diagnostic_msgs/msg/key_value.hpp"
+
 #include <rclcpp/rclcpp.hpp>
 
 #include <tf2_ros/transform_broadcaster.h>
 
 #include "common.h"
 #include "agent.h"
-#include "kdtree.h"
+#include "swarm_planner.h"
+#include "job_queue.h"
+#include "pose_smoother.h"
+#include "pose_history.h"
+#include "landmark_table.h"
+#include "swarm_smoother.h"
+#include "group_masks.h"
+#include "piecewise_trajectory.h"
+#include "command_scheduler.h"
+#include "latency_histogram.h"
+#include "tracing.h"
 
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
@@ -85,6 +106,10 @@ using motion_capture_tracking_interfaces::msg::NamedPose;
 using visualization_msgs::msg::MarkerArray;
 using visualization_msgs::msg::Marker;
 
+using diagnostic_msgs::msg::DiagnosticArray;
+using diagnostic_msgs::msg::DiagnosticStatus;
+using diagnostic_msgs::msg::KeyValue;
+
 using std::placeholders::_1;
 using std::placeholders::_2;
 
@@ -103,11 +128,35 @@ namespace cs2
     {
         public:
 
-            cs2_application()
-                : Node("cs2_application"), clock(RCL_ROS_TIME), tf2_bc(this)
+            explicit cs2_application(
+                const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+                : Node("cs2_application", options), clock(RCL_ROS_TIME), tf2_bc(this)
             {
                 start_node_time = clock.now();
 
+                // planning runs on its own executor thread, see
+                // start_planning_thread, the relocalization solve and user
+                // commands cannot hold it up
+                planning_group = this->create_callback_group(
+                    rclcpp::CallbackGroupType::MutuallyExclusive, false);
+                ingestion_group = this->create_callback_group(
+                    rclcpp::CallbackGroupType::Reentrant);
+                // one tag callback at a time, each is the only producer of
+                // its agent's tag ring
+                tag_group = this->create_callback_group(
+                    rclcpp::CallbackGroupType::MutuallyExclusive);
+                relocalization_group = this->create_callback_group(
+                    rclcpp::CallbackGroupType::MutuallyExclusive);
+                user_group = this->create_callback_group(
+                    rclcpp::CallbackGroupType::MutuallyExclusive);
+
+                rclcpp::SubscriptionOptions ingestion_options;
+                ingestion_options.callback_group = ingestion_group;
+                rclcpp::SubscriptionOptions tag_options;
+                tag_options.callback_group = tag_group;
+                rclcpp::SubscriptionOptions user_options;
+                user_options.callback_group = user_group;
+
                 // declare global commands
                 this->declare_parameter("queue_size", 1);
 
@@ -120,11 +169,37 @@ namespace cs2
                 this->declare_parameter("trajectory_parameters.protected_zone", -1.0);
                 this->declare_parameter("trajectory_parameters.planning_horizon_scale", -1.0);
                 this->declare_parameter("trajectory_parameters.height_range");
+                this->declare_parameter("trajectory_parameters.planning_threads", 1);
+                this->declare_parameter("trajectory_parameters.event_driven_planning", false);
+                this->declare_parameter("trajectory_parameters.event_planning_rate", 100.0);
+                this->declare_parameter("trajectory_parameters.planning_priority", 0);
+                this->declare_parameter("trajectory_parameters.group_broadcast", true);
+                this->declare_parameter("trajectory_parameters.group_mask_timeout", 0.5);
+                this->declare_parameter("trajectory_parameters.group_duration_tolerance", 0.1);
+                this->declare_parameter("trajectory_parameters.trajectory_upload", false);
+                this->declare_parameter("trajectory_parameters.conflict_threshold", 0.1);
+
+                this->declare_parameter("diagnostics_period", 1.0);
+
+                this->declare_parameter("command_stream.velocity_deadband", 0.0);
+                this->declare_parameter("command_stream.height_deadband", 0.0);
+                this->declare_parameter("command_stream.keep_alive", 0.0);
+                this->declare_parameter("command_stream.radio_rate", 0.0);
+
+                this->declare_parameter("pose_ingestion.mode", "per_agent");
+                this->declare_parameter("pose_ingestion.topic", "/poses");
+                this->declare_parameter("pose_ingestion.velocity_topics", false);
+                this->declare_parameter("pose_ingestion.velocity_smoothing", 0.5);
 
                 this->declare_parameter("april_tag_parameters.camera_rotation");
                 this->declare_parameter("april_tag_parameters.time_threshold", -1.0);
                 this->declare_parameter("april_tag_parameters.observation_threshold", -1.0);
                 this->declare_parameter("april_tag_parameters.observation_limit", 1);
+                this->declare_parameter("april_tag_parameters.relocalization_threads", 2);
+                this->declare_parameter("april_tag_parameters.relocalization_window", 10);
+                this->declare_parameter("april_tag_parameters.joint_relocalization", false);
+                this->declare_parameter("april_tag_parameters.tag_queue_capacity", 16);
+                this->declare_parameter("april_tag_parameters.tag_queue_policy", "overwrite_oldest");
 
                 max_queue_size = 
                     this->get_parameter("queue_size").get_parameter_value().get<int>();
@@ -145,10 +220,63 @@ namespace cs2
                     this->get_parameter("trajectory_parameters.protected_zone").get_parameter_value().get<double>();
                 planning_horizon_scale = 
                     this->get_parameter("trajectory_parameters.planning_horizon_scale").get_parameter_value().get<double>();
+                int planning_threads = 
+                    this->get_parameter("trajectory_parameters.planning_threads").get_parameter_value().get<int>();
+                event_driven_planning = 
+                    this->get_parameter("trajectory_parameters.event_driven_planning").get_parameter_value().get<bool>();
+                event_planning_rate = 
+                    this->get_parameter("trajectory_parameters.event_planning_rate").get_parameter_value().get<double>();
+                planning_priority = 
+                    this->get_parameter("trajectory_parameters.planning_priority").get_parameter_value().get<int>();
+                group_broadcast = 
+                    this->get_parameter("trajectory_parameters.group_broadcast").get_parameter_value().get<bool>();
+                group_mask_timeout = 
+                    this->get_parameter("trajectory_parameters.group_mask_timeout").get_parameter_value().get<double>();
+                group_duration_tolerance = 
+                    this->get_parameter("trajectory_parameters.group_duration_tolerance").get_parameter_value().get<double>();
+                group_duration_tolerance = std::max(group_duration_tolerance, 0.0);
+                trajectory_upload = 
+                    this->get_parameter("trajectory_parameters.trajectory_upload").get_parameter_value().get<bool>();
+                conflict_threshold = 
+                    this->get_parameter("trajectory_parameters.conflict_threshold").get_parameter_value().get<double>();
                 std::vector<double> height_range_vector = 
                     this->get_parameter("trajectory_parameters.height_range").get_parameter_value().get<std::vector<double>>();
                 assert(height_range_vector.size() == 2);
 
+                double diagnostics_period = 
+                    this->get_parameter("diagnostics_period").get_parameter_value().get<double>();
+
+                scheduler_parameters scheduler_param;
+                scheduler_param.velocity_deadband = 
+                    this->get_parameter("command_stream.velocity_deadband").get_parameter_value().get<double>();
+                scheduler_param.height_deadband = 
+                    this->get_parameter("command_stream.height_deadband").get_parameter_value().get<double>();
+                scheduler_param.keep_alive = 
+                    this->get_parameter("command_stream.keep_alive").get_parameter_value().get<double>();
+                scheduler_param.radio_rate = 
+                    this->get_parameter("command_stream.radio_rate").get_parameter_value().get<double>();
+                // one planning tick of commands can go out at once
+                scheduler_param.radio_burst = 
+                    std::max(scheduler_param.radio_rate / planning_rate, 1.0);
+                velocity_scheduler = std::make_unique<command_scheduler>(scheduler_param);
+
+                std::string pose_ingestion_mode =
+                    this->get_parameter("pose_ingestion.mode").get_parameter_value().get<std::string>();
+                std::string pose_ingestion_topic =
+                    this->get_parameter("pose_ingestion.topic").get_parameter_value().get<std::string>();
+                bool velocity_topics =
+                    this->get_parameter("pose_ingestion.velocity_topics").get_parameter_value().get<bool>();
+                velocity_smoothing =
+                    this->get_parameter("pose_ingestion.velocity_smoothing").get_parameter_value().get<double>();
+                velocity_smoothing = std::clamp(velocity_smoothing, 0.0, 1.0);
+                named_pose_ingestion = 
+                    strcmp(pose_ingestion_mode.c_str(), "named_pose_array") == 0;
+                if (!named_pose_ingestion && strcmp(pose_ingestion_mode.c_str(), "per_agent") != 0)
+                    RCLCPP_ERROR(this->get_logger(), "pose_ingestion mode %s is not known, per_agent is used", 
+                        pose_ingestion_mode.c_str());
+                // per agent mode always has the velocity topics
+                estimate_velocity = named_pose_ingestion && !velocity_topics;
+
                 std::vector<double> camera_rotation = 
                     this->get_parameter("april_tag_parameters.camera_rotation").get_parameter_value().get<std::vector<double>>();
                 time_threshold = 
@@ -157,6 +285,22 @@ namespace cs2
                     this->get_parameter("april_tag_parameters.observation_threshold").get_parameter_value().get<double>();
                 observation_limit =
                     this->get_parameter("april_tag_parameters.observation_limit").get_parameter_value().get<int>();
+                int relocalization_threads =
+                    this->get_parameter("april_tag_parameters.relocalization_threads").get_parameter_value().get<int>();
+                int relocalization_window =
+                    this->get_parameter("april_tag_parameters.relocalization_window").get_parameter_value().get<int>();
+                joint_relocalization =
+                    this->get_parameter("april_tag_parameters.joint_relocalization").get_parameter_value().get<bool>();
+                int tag_queue_capacity =
+                    this->get_parameter("april_tag_parameters.tag_queue_capacity").get_parameter_value().get<int>();
+                std::string tag_queue_policy =
+                    this->get_parameter("april_tag_parameters.tag_queue_policy").get_parameter_value().get<std::string>();
+                overflow_policy tag_overflow = overflow_policy::overwrite_oldest;
+                if (strcmp(tag_queue_policy.c_str(), "drop_newest") == 0)
+                    tag_overflow = overflow_policy::drop_newest;
+                else if (strcmp(tag_queue_policy.c_str(), "overwrite_oldest") != 0)
+                    RCLCPP_ERROR(this->get_logger(), "tag_queue_policy %s is not known, overwrite_oldest is used", 
+                        tag_queue_policy.c_str());
 
                 static_camera_transform = Eigen::Affine3d::Identity();
                 // Quaterniond is w,x,y,z
@@ -167,12 +311,35 @@ namespace cs2
                 std::cout << "camera_rotation:" << std::endl;
                 std::cout << static_camera_transform.linear() << std::endl;
 
+                // rotate z -90 then x -90 for it to be FRD
+                nwu_to_rdf = enu_to_rdf = Eigen::Affine3d::Identity();
+                nwu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(0,0,1)));
+                
+                nwu_to_enu = nwu_to_rdf;
+                enu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(1,0,0)));
+                nwu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(1,0,0)));
+
+                // one noise model shared by every landmark prior
+                landmark_noise = gtsam::noiseModel::Diagonal::Sigmas(
+                    gtsam::Vector6::Constant(relocalization_sigma));
+
                 height_range = 
                     std::make_pair(height_range_vector[0], height_range_vector[1]);
 
                 time_threshold = 
                     this->get_parameter("april_tag_parameters.time_threshold").get_parameter_value().get<double>();
 
+                planner_parameters planner_param;
+                planner_param.time_step = 1/planning_rate;
+                planner_param.max_neighbours = 10;
+                planner_param.max_velocity = max_velocity;
+                planner_param.communication_radius = communication_radius;
+                planner_param.protected_zone = protected_zone;
+                planner_param.time_horizon = planning_horizon_scale * 1/planning_rate;
+                planner_param.height_range = height_range;
+                planner_param.threads = (size_t)std::max(planning_threads, 1);
+                planner = std::make_unique<swarm_planner>(planner_param);
+
                 // load crazyflies from params
                 auto node_parameters_iface = this->get_node_parameters_interface();
                 const std::map<std::string, rclcpp::ParameterValue> &parameter_overrides =
@@ -183,72 +350,144 @@ namespace cs2
                 {
                     RCLCPP_INFO(this->get_logger(), "creating agent map for '%s'", name.c_str());
 
-                    std::string str_copy = name;
-                    // Remove cf from cfXX
-                    str_copy.erase(0,2);
-                    int id = std::stoi(str_copy);
-
                     std::vector<double> pos = parameter_overrides.at("robots." + name + ".initial_position").get<std::vector<double>>();
                     bool mission_capable = parameter_overrides.at("robots." + name + ".mission_capable").get<bool>();
 
-                    agent_state a_s;
-                    Eigen::Affine3d aff = Eigen::Affine3d::Identity();
-                    aff.translation() = Eigen::Vector3d(pos[0], pos[1], pos[2]);
-                    a_s.t = clock.now();
-                    a_s.transform = aff;
-                    a_s.flight_state = IDLE;
-                    a_s.radio_connection = false;
-                    a_s.completed = false;
-                    a_s.mission_capable = mission_capable;
-
                     // RCLCPP_INFO(this->get_logger(), "(%s) %lf %lf %lf", name.c_str(), 
                     //     pos[0], pos[1], pos[2]);
 
-                    // to get the index of string std::stoi(str_copy)
-                    agents_states.insert(
-                        std::pair<std::string, agent_state>(name, a_s));
+                    // every per agent container below is indexed the same as the registry
+                    size_t index = swarm.add(name, 
+                        Eigen::Vector3d(pos[0], pos[1], pos[2]), mission_capable, clock.now());
 
-                    std::function<void(const PoseStamped::SharedPtr)> pcallback = 
+                    // radio://N/... shares the budget of radio N
+                    size_t radio = 0;
+                    auto uri = parameter_overrides.find("robots." + name + ".uri");
+                    std::smatch radio_match;
+                    if (uri != parameter_overrides.end() && 
+                        uri->second.get_type() == rclcpp::ParameterType::PARAMETER_STRING)
+                    {
+                        const std::string &uri_string = uri->second.get<std::string>();
+                        if (std::regex_search(uri_string, radio_match, std::regex("radio://([0-9]+)/")))
+                            radio = std::stoul(radio_match[1].str());
+                    }
+                    velocity_scheduler->add_agent(radio);
+
+                    // const references, within the process the messages are not copied
+                    std::function<void(const PoseStamped &)> pcallback = 
                         std::bind(&cs2_application::pose_callback,
-                        this, std::placeholders::_1, --agents_states.end());
-                    std::function<void(const Twist::SharedPtr)> vcallback = 
+                        this, std::placeholders::_1, index);
+                    std::function<void(const Twist &)> vcallback = 
                         std::bind(&cs2_application::twist_callback,
-                        this, std::placeholders::_1, --agents_states.end());
-                    std::function<void(const AprilTagDetectionArray::SharedPtr)> tcallback = 
-                        std::bind(&cs2_application::tag_callback, this, std::placeholders::_1, name);
+                        this, std::placeholders::_1, index);
+                    std::function<void(const AprilTagDetectionArray &)> tcallback = 
+                        std::bind(&cs2_application::tag_callback, this, std::placeholders::_1, index);
                     
                     agent_struct tmp;
                     tmp.go_to = this->create_client<GoTo>(name + "/go_to");
                     tmp.land = this->create_client<Land>(name + "/land");
                     tmp.set_group = this->create_client<SetGroupMask>(name + "/set_group_mask");
+                    if (trajectory_upload)
+                    {
+                        tmp.upload_trajectory = 
+                            this->create_client<UploadTrajectory>(name + "/upload_trajectory");
+                        tmp.start_trajectory = 
+                            this->create_client<StartTrajectory>(name + "/start_trajectory");
+                        tmp.notify_setpoints_stop = 
+                            this->create_client<NotifySetpointsStop>(name + "/notify_setpoints_stop");
+                    }
                     
-                    pose_sub.insert({name, this->create_subscription<PoseStamped>(
-                        name + "/pose", 7, pcallback)});
-                    vel_sub.insert({name, this->create_subscription<Twist>(
-                        name + "/vel", 7, vcallback)});
-                    tag_sub.insert({name, this->create_subscription<AprilTagDetectionArray>(
-                        name + "/tag", 7, tcallback)});
+                    // the aggregated mode takes every pose from one topic
+                    if (!named_pose_ingestion)
+                        pose_sub.push_back(this->create_subscription<PoseStamped>(
+                            name + "/pose", 7, pcallback, ingestion_options));
+                    if (!estimate_velocity)
+                        vel_sub.push_back(this->create_subscription<Twist>(
+                            name + "/vel", 7, vcallback, ingestion_options));
+                    tag_sub.push_back(this->create_subscription<AprilTagDetectionArray>(
+                        name + "/tag", 7, tcallback, tag_options));
 
                     tmp.vel_world_publisher = 
                         this->create_publisher<VelocityWorld>(name + "/cmd_velocity_world", 10);
 
-                    tag_queue empty = tag_queue();
-
-                    agents_tag_queue.insert({name, empty});
-                    agents_comm.insert({name, tmp});
+                    agents_tag_queue.emplace_back(
+                        (size_t)std::max(tag_queue_capacity, 1), tag_overflow);
+                    tag_drops_reported.push_back(0);
+                    agents_pose_history.emplace_back((size_t)std::max(max_queue_size, 2));
+                    agents_pose_sequence.emplace_back(0);
+                    agents_trace.emplace_back();
+                    agents_comm.push_back(tmp);
                 
-                    Agent new_rvo2_agent = Agent(
-                        id, (float)(1/planning_rate), 10, (float)max_velocity, 
-                        (float)communication_radius, (float)protected_zone, 
-                        (float)(planning_horizon_scale * 1/planning_rate),
-                        (float)height_range.first, (float)height_range.second);
-                    rvo_agents.insert({name, new_rvo2_agent});
+                    planner->add_agent(swarm.ids[index]);
 
-                    agents_loop_closure.insert({name, factor_graph()});
+                    agents_loop_closure.push_back(factor_graph());
+                    agents_smoother.emplace_back(
+                        (size_t)std::max(relocalization_window, 1), relocalization_sigma);
 
                     RCLCPP_INFO(this->get_logger(), "agent %s created", name.c_str());
                 }
 
+                if (named_pose_ingestion)
+                {
+                    // one callback at a time, the velocity estimate needs
+                    // the frames in order
+                    rclcpp::SubscriptionOptions named_pose_options;
+                    named_pose_options.callback_group = this->create_callback_group(
+                        rclcpp::CallbackGroupType::MutuallyExclusive);
+                    // the relocalization corrections go out on poses, they
+                    // must not come back in as motion capture
+                    named_pose_options.ignore_local_publications = true;
+                    named_pose_sub = this->create_subscription<NamedPoseArray>(
+                        pose_ingestion_topic, 7, 
+                        std::bind(&cs2_application::named_poses_callback, this, _1), 
+                        named_pose_options);
+                    RCLCPP_INFO(this->get_logger(), "poses of the swarm from %s (velocity %s)", 
+                        pose_ingestion_topic.c_str(), estimate_velocity ? "estimated" : "from <cf>/vel");
+                }
+
+                command_groups = std::make_unique<group_masks>(swarm.size());
+
+                agents_trajectory.resize(swarm.size());
+                trajectory_desired.assign(swarm.size(), Eigen::Vector3d::Zero());
+
+                velocity_commands.reserve(swarm.size());
+                event_commands.reserve(swarm.size());
+                event_pending.assign(swarm.size(), 0);
+                event_last_plan.assign(swarm.size(), std::chrono::steady_clock::time_point());
+
+                // the factor graph solves run here instead of in the tag timer
+                relocalization_busy.assign(swarm.size(), 0);
+                if (joint_relocalization)
+                    joint_smoother = std::make_unique<swarm_smoother>(swarm.size(), 
+                        (size_t)std::max(relocalization_window, 1), relocalization_sigma);
+                relocalization_queue = std::make_unique<job_queue>(
+                    (size_t)std::max(relocalization_threads, 1));
+
+                std::vector<Eval_obstacle> walls;
+                for (const auto &[name, obs] : load_obstacles(parameter_overrides))
+                {
+                    if (strcmp(obs.type.c_str(), wall_disjointed.c_str()) != 0)
+                    {
+                        RCLCPP_WARN(this->get_logger(), "obstacle %s has unknown type %s", 
+                            name.c_str(), obs.type.c_str());
+                        continue;
+                    }
+
+                    for (size_t i = 0; i + 1 < obs.points.size(); i++)
+                    {
+                        Eval_obstacle wall;
+                        wall.start_ = obs.points[i].cast<float>();
+                        wall.end_ = obs.points[i+1].cast<float>();
+                        wall.minHeight_ = (float)obs.height.first;
+                        wall.maxHeight_ = (float)obs.height.second;
+                        walls.push_back(wall);
+                    }
+
+                    RCLCPP_INFO(this->get_logger(), "obstacle %s created (%zu walls)", 
+                        name.c_str(), obs.points.size() > 1 ? obs.points.size() - 1 : 0);
+                }
+                planner->set_obstacles(walls);
+
                 std::vector<double> _pair_location_list = 
                     parameter_overrides.at("april_tags.pair_position").get<std::vector<double>>();
                 std::vector<double> _pair_paper_list = 
@@ -307,7 +546,11 @@ namespace cs2
                                     tag_pos += _pair_location[i] + Eigen::Vector2d(_paper_size.x(), 0.0);
                             }
 
-                            april_relocalize.insert({id, tag_pos});
+                            Eigen::Affine3d world_to_tag = nwu_to_enu;
+                            world_to_tag.translation() = 
+                                Eigen::Vector3d(tag_pos.x(), tag_pos.y(), 0.0);
+                            if (!landmarks.add(id, world_to_tag, landmark_noise))
+                                RCLCPP_ERROR(this->get_logger(), "tag %d cannot be added as a landmark", id);
                         }
                         else if (strcmp(purpose.c_str(), eliminate.c_str()) == 0)
                             april_eliminate.insert({id, Eigen::Vector2d::Zero()});
@@ -319,6 +562,13 @@ namespace cs2
 
                 pose_publisher = 
                     this->create_publisher<NamedPoseArray>("poses", 7);
+
+                // another node on the topic still mixes the corrections
+                // into the poses, the tags are for flying without mocap
+                if (named_pose_ingestion && landmarks.size() > 0)
+                    RCLCPP_WARN(this->get_logger(), "relocalization tags are set with "
+                        "named_pose_array ingestion, the corrections are published on "
+                        "poses next to %s", pose_ingestion_topic.c_str());
                 
                 target_publisher = 
                     this->create_publisher<MarkerArray>("targets", 7);
@@ -327,29 +577,59 @@ namespace cs2
                     this->create_publisher<AgentsStateFeedback>("agents", 7);
 
                 subscription_user = 
-                    this->create_subscription<UserCommand>("user", 7, std::bind(&cs2_application::user_callback, this, _1));
+                    this->create_subscription<UserCommand>("user", 7, 
+                    std::bind(&cs2_application::user_callback, this, _1), user_options);
+
+                // latency percentiles of the stages instead of per tick logs
+                diagnostics_publisher = 
+                    this->create_publisher<DiagnosticArray>("/diagnostics", 10);
+                if (diagnostics_period > 0.0)
+                    diagnostics_timer = this->create_wall_timer(
+                        std::chrono::duration<double>(diagnostics_period), 
+                        std::bind(&cs2_application::diagnostics_timer_callback, this));
 
                 takeoff_all_client = this->create_client<Takeoff>("/all/takeoff");
                 land_all_client = this->create_client<Land>("/all/land");
+                go_to_all_client = this->create_client<GoTo>("/all/go_to");
 
                 tag_timer = this->create_wall_timer(
-                    200ms, std::bind(&cs2_application::tag_timer_callback, this));
+                    200ms, std::bind(&cs2_application::tag_timer_callback, this), 
+                    relocalization_group);
 
                 auto t_planning = (1/planning_rate) * 1000ms;
                 handler_timer = this->create_wall_timer(
-                    t_planning, std::bind(&cs2_application::handler_timer_callback, this));
+                    t_planning, std::bind(&cs2_application::handler_timer_callback, this),
+                    planning_group);
 
-                RCLCPP_INFO(this->get_logger(), "end_constructor");
+                // plans an agent as soon as its pose arrives, next to the planning tick
+                if (event_driven_planning && event_planning_rate > 0.0)
+                    event_thread = std::thread(&cs2_application::event_planning_loop, this);
 
-                // rotate z -90 then x -90 for it to be FRD
-                nwu_to_rdf = enu_to_rdf = Eigen::Affine3d::Identity();
-                nwu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(0,0,1)));
-                
-                nwu_to_enu = nwu_to_rdf;
-                enu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(1,0,0)));
-                nwu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(1,0,0)));
+                start_planning_thread();
+
+                RCLCPP_INFO(this->get_logger(), "end_constructor");
             };
 
+            ~cs2_application()
+            {
+                // no planning tick runs past this
+                planning_executor.cancel();
+                if (planning_thread.joinable())
+                    planning_thread.join();
+
+                // the solves use the members below, finish them first
+                relocalization_queue.reset();
+
+                {
+                    std::lock_guard<std::mutex> lock(event_mutex);
+                    event_stop = true;
+                }
+                event_cv.notify_all();
+
+                if (event_thread.joinable())
+                    event_thread.join();
+            }
+
         private:
 
             // parameters
@@ -363,12 +643,19 @@ namespace cs2
             double communication_radius;
             double protected_zone;
             double planning_horizon_scale;
+            // per agent cap of the pose triggered plans
+            double event_planning_rate;
             // threshold parameters
             double time_threshold;
             double observation_threshold;
 
             int observation_limit;
 
+            bool event_driven_planning;
+
+            // SCHED_FIFO priority of the planning thread, 0 keeps the default
+            int planning_priority;
+
             Eigen::Affine3d nwu_to_rdf;
             Eigen::Affine3d enu_to_rdf;
             Eigen::Affine3d nwu_to_enu;
@@ -377,38 +664,210 @@ namespace cs2
 
             rclcpp::Client<Takeoff>::SharedPtr takeoff_all_client;
             rclcpp::Client<Land>::SharedPtr land_all_client;
+            rclcpp::Client<GoTo>::SharedPtr go_to_all_client;
+
+            // go_to and land for several agents as one broadcast on /all
+            bool group_broadcast;
+            // wait for the group masks before the agents are sent one by one
+            double group_mask_timeout;
+            // the agents of a broadcast fly at most this much longer (s)
+            double group_duration_tolerance;
+            // group masks of the agents, guarded by planning_mutex
+            std::unique_ptr<group_masks> command_groups;
+
+            /** @brief a broadcast waiting for the group masks it changed **/
+            struct pending_broadcast
+            {
+                std::mutex mutex;
+                size_t pending;
+                bool done = false;
+                std::vector<uint8_t> acknowledged;
+                rclcpp::TimerBase::SharedPtr timeout;
+            };
 
-            std::map<std::string, agent_struct> agents_comm;
-            std::map<std::string, agent_state> agents_states;
-
-            std::map<std::string, rclcpp::Subscription<PoseStamped>::SharedPtr> pose_sub;
-            std::map<std::string, rclcpp::Subscription<Twist>::SharedPtr> vel_sub;
-            std::map<std::string, rclcpp::Subscription<AprilTagDetectionArray>::SharedPtr> tag_sub;
+            /** 
+             * @brief goto_velocity targets flown onboard. The targets are
+             * uploaded as a trajectory and only streamed as velocities
+             * while ORCA moves the agent off it, guarded by planning_mutex
+            **/
+            bool trajectory_upload;
+            // ORCA velocity this far from the trajectory hands it to the stream
+            double conflict_threshold;
+            // pieces of one trajectory, two fit the crazyflie trajectory memory
+            const size_t trajectory_pieces = 15;
+            struct agent_trajectory
+            {
+                piecewise_trajectory plan;
+                // the target queue when uploaded, and how many are in plan
+                std::vector<Eigen::Vector3d> targets;
+                size_t uploaded = 0;
+                std::chrono::steady_clock::time_point start;
+                bool active = false;
+                bool streaming = false;
+                // the trajectory memory half that is written next
+                uint8_t slot = 0;
+            };
+            std::vector<agent_trajectory> agents_trajectory;
+            // velocity of the trajectory that ORCA was given in this tick
+            std::vector<Eigen::Vector3d> trajectory_desired;
+
+            // the swarm, the per agent vectors below share its indexing
+            swarm_registry swarm;
+
+            std::vector<agent_struct> agents_comm;
+
+            std::vector<rclcpp::Subscription<PoseStamped>::SharedPtr> pose_sub;
+            std::vector<rclcpp::Subscription<Twist>::SharedPtr> vel_sub;
+            std::vector<rclcpp::Subscription<AprilTagDetectionArray>::SharedPtr> tag_sub;
+
+            // the whole swarm from one NamedPoseArray instead of <cf>/pose
+            bool named_pose_ingestion;
+            rclcpp::Subscription<NamedPoseArray>::SharedPtr named_pose_sub;
+            // velocity from consecutive poses when <cf>/vel is not subscribed
+            bool estimate_velocity;
+            // weight of the last velocity in the estimate, 0 keeps no history
+            double velocity_smoothing;
+
+            /** 
+             * @brief agent of every position of the pose array, the array
+             * keeps its order from frame to frame so the name is compared
+             * instead of looked up. Bodies that are not agents keep npos
+            **/
+            struct pose_slot
+            {
+                std::string name;
+                size_t index;
+            };
+            std::vector<pose_slot> pose_slots;
 
-            std::map<std::string, tag_queue> agents_tag_queue;
+            std::deque<tag_queue> agents_tag_queue;
+            // drops of each tag ring that were logged already
+            std::vector<uint64_t> tag_drops_reported;
+            // poses of the last queue_size messages, for the tag stamps
+            std::deque<pose_history> agents_pose_history;
+            // numbers the poses of every agent as they are ingested
+            std::deque<std::atomic<uint64_t>> agents_pose_sequence;
 
             std::map<int, Eigen::Vector2d> april_eliminate;
-            std::map<int, Eigen::Vector2d> april_relocalize;
-            std::map<std::string, Agent> rvo_agents;
-
-            std::map<std::string, factor_graph> agents_loop_closure;
+            // relocalization tags, not written after construction
+            landmark_table landmarks;
+            gtsam::SharedNoiseModel landmark_noise;
+
+            // observations since the last relocalization job
+            std::vector<factor_graph> agents_loop_closure;
+            // only touched by the relocalization job of the agent
+            std::deque<pose_smoother> agents_smoother;
+            const double relocalization_sigma = 0.03;
+
+            // relocalization solves, at most one per agent queued or running
+            std::unique_ptr<job_queue> relocalization_queue;
+            std::mutex relocalization_mutex;
+            std::vector<uint8_t> relocalization_busy;
+            // one graph for the whole swarm instead of agents_smoother
+            bool joint_relocalization;
+            std::unique_ptr<swarm_smoother> joint_smoother;
+            bool joint_relocalization_busy = false;
 
             std::pair<double, double> height_range;
 
+            rclcpp::CallbackGroup::SharedPtr planning_group;
+            rclcpp::CallbackGroup::SharedPtr ingestion_group;
+            rclcpp::CallbackGroup::SharedPtr tag_group;
+            rclcpp::CallbackGroup::SharedPtr relocalization_group;
+            rclcpp::CallbackGroup::SharedPtr user_group;
+
+            // spins planning_group only, see start_planning_thread
+            rclcpp::executors::SingleThreadedExecutor planning_executor;
+            std::thread planning_thread;
+
+            /** 
+             * @brief deviation of the planning tick period from 1/planning_rate,
+             * in its latency stage so relocalization bursts show up there
+            **/
+            struct tick_jitter
+            {
+                std::chrono::steady_clock::time_point last;
+                bool started = false;
+            };
+            tick_jitter planning_jitter;
+
+            /** @brief stages of the hot paths that are timed **/
+            enum latency_stage
+            {
+                POSE_INGESTION,
+                // the snapshot and the grid rebuild
+                NEIGHBOUR_INDEX,
+                // the neighbour queries and the solve of every agent
+                ORCA_SOLVE,
+                COMMAND_PUBLISH,
+                PLANNING_JITTER,
+                TAG_CALLBACK,
+                TAG_HANDLE,
+                RELOCALIZATION_WAIT,
+                RELOCALIZATION_SOLVE,
+                MISSION_DISPATCH,
+                LATENCY_STAGES
+            };
+            std::array<latency_histogram, LATENCY_STAGES> stage_latency;
+
+            /** 
+             * @brief end to end trace of the commands of one agent, back to
+             * the pose each was planned from
+            **/
+            struct agent_trace
+            {
+                // source stamp of the pose to the publish, on the ros clock
+                latency_histogram latency;
+                // ingestion of the pose to the publish, on the steady clock
+                latency_histogram staleness;
+                // pose of the last published command, and the commands sent
+                // again from a pose that an earlier command was planned from
+                uint64_t last_sequence = 0;
+                uint64_t repeated = 0;
+            };
+            std::deque<agent_trace> agents_trace;
+
+            rclcpp::Publisher<DiagnosticArray>::SharedPtr diagnostics_publisher;
+            rclcpp::TimerBase::SharedPtr diagnostics_timer;
+
             rclcpp::TimerBase::SharedPtr planning_timer;
             rclcpp::TimerBase::SharedPtr tag_timer;
             rclcpp::TimerBase::SharedPtr handler_timer;
         
             tf2_ros::TransformBroadcaster tf2_bc;
 
-            std::mutex agent_update_mutex;
-            std::mutex tag_queue_mutex;
-
             rclcpp::Clock clock;
 
             rclcpp::Time start_node_time;
 
-            kdtree *kd_tree;
+            // ORCA planning of the swarm, indexed the same as the registry
+            std::unique_ptr<swarm_planner> planner;
+
+            std::vector<velocity_command> velocity_commands;
+
+            // deadband, keep alive and radio budget of the velocity stream
+            std::unique_ptr<command_scheduler> velocity_scheduler;
+            // the commands of a publish that go out, reused
+            std::vector<velocity_command> scheduled_commands;
+            std::vector<double> command_urgency;
+
+            // guards the flight states, targets and planner once the event
+            // planning thread runs next to the executor
+            std::mutex planning_mutex;
+
+            /** 
+             * @brief pose triggered planning, a pose marks its agent pending
+             * and the event thread plans all pending agents in one batch.
+             * An agent is planned at most event_planning_rate times a second
+            **/
+            std::thread event_thread;
+            std::mutex event_mutex;
+            std::condition_variable event_cv;
+            std::vector<uint8_t> event_pending;
+            size_t event_pending_count = 0;
+            std::vector<std::chrono::steady_clock::time_point> event_last_plan;
+            bool event_stop = false;
+            std::vector<velocity_command> event_commands;
 
             rclcpp::Subscription<UserCommand>::SharedPtr subscription_user;
 
@@ -416,40 +875,116 @@ namespace cs2
             rclcpp::Publisher<AgentsStateFeedback>::SharedPtr agent_state_publisher;
             rclcpp::Publisher<MarkerArray>::SharedPtr target_publisher;
             
-            void conduct_planning(
-                Eigen::Vector3d &desired, std::string mykey, agent_state state);
+            void rebuild_neighbour_index();
 
-            void user_callback(const UserCommand::SharedPtr msg);
+            void plan_swarm_velocities();
+
+            velocity_command velocity_towards(
+                size_t index, const Eigen::Vector3d &target) const;
+
+            void publish_velocity_commands(
+                const std::vector<velocity_command> &commands);
+
+            /** @brief close to a neighbour or to the target goes first on the radio **/
+            double command_urgency_of(const velocity_command &command) const;
+
+            /** @brief velocity of the trajectory now, uploads it if the targets changed **/
+            velocity_command trajectory_command(size_t index);
+
+            /** 
+             * @brief take the agents that follow their trajectory out of the
+             * commands, and the ones ORCA moves off it onto the stream
+            **/
+            void separate_trajectory_commands(std::vector<velocity_command> &commands);
+
+            /** 
+             * @brief upload and start the targets, release ends the stream
+             * first, false when the services are not there and the agent
+             * stays on the stream
+            **/
+            bool upload_trajectory(size_t index, 
+                const std::vector<Eigen::Vector3d> &targets, bool release);
+
+            /** @brief the agent is given to a high level command **/
+            void leave_trajectory(size_t index);
+
+            void notify_pose_event(size_t index);
+
+            void event_planning_loop();
+
+            void plan_pose_events(const std::vector<size_t> &batch);
+
+            /** @brief the snapshot pose each command is planned from **/
+            void trace_commands(std::vector<velocity_command> &commands) const;
+
+            void user_callback(const UserCommand &msg);
 
             void pose_callback(
-                const PoseStamped::SharedPtr msg, 
-                std::map<std::string, agent_state>::iterator state);
+                const PoseStamped &msg, size_t index);
+
+            void named_poses_callback(const NamedPoseArray &msg);
+
+            /** @brief hand the pose sample of the agent to the planner and tag handler **/
+            void ingest_pose(size_t index, pose_sample sample);
+
+            /** @brief velocity of the agent from its last pose and the new one **/
+            void estimate_twist(size_t index, const pose_sample &sample);
             
             void twist_callback(
-                const Twist::SharedPtr msg, 
-                std::map<std::string, agent_state>::iterator state);
+                const Twist &msg, size_t index);
             
-            void tag_callback(const AprilTagDetectionArray::SharedPtr& msg, std::string name);
+            void tag_callback(const AprilTagDetectionArray &msg, size_t index);
+
+            /** @brief take the tags out of the ring of the agent **/
+            void drain_tags(size_t index, std::queue<tag> &tags);
 
             // timers
             void tag_timer_callback();
             void handler_timer_callback(); 
 
-            void send_land_and_update(
-                std::map<std::string, agent_state>::iterator s,
-                std::map<std::string, agent_struct>::iterator c);
+            void record_planning_jitter();
+
+            /** @brief publish the percentiles of every stage and agent and start them over **/
+            void diagnostics_timer_callback();
+
+            void start_planning_thread();
+
+            void send_land_and_update(size_t index);
 
-            void handle_eliminate(
-                std::map<std::string, agent_state>::iterator s, tag t);
+            /** 
+             * @brief put the agents alone in a group bit and call send with
+             * its mask, once the group masks that changed are acknowledged.
+             * If they are not within group_mask_timeout, fallback is called
+             * instead to send the command to each agent
+            **/
+            void broadcast_to_group(const std::vector<size_t> &members, 
+                std::function<void(uint8_t)> send, std::function<void()> fallback);
 
-            bool handle_relocalize(
-                std::queue<agent_state> &q, tag t, 
-                std::map<int, Eigen::Vector2d>::iterator tag_pose, 
-                std::string id);
+            void handle_eliminate(size_t index, tag t);
+
+            bool handle_relocalize(tag t, size_t index);
     
-            void gtsam_pose_optimization(
-                Eigen::Affine3d &pose, 
-                std::map<std::string, factor_graph>::iterator fact_it,
-                std::map<std::string, agent_state>::iterator agent_it);
+            void post_relocalization(size_t index);
+
+            void post_joint_relocalization();
+
+            void publish_pose_correction(
+                size_t index, const Eigen::Affine3d &pose_opt);
+
+            /** @brief smoother states of the observations, in their order **/
+            void build_smoother_states(
+                const factor_graph &fact, std::vector<smoother_state> &states) const;
+
+            /** @brief latest pose of the agent with the error applied **/
+            Eigen::Affine3d corrected_pose(size_t index, 
+                const Eigen::Vector3d &translation_error, 
+                const Eigen::Quaterniond &rotation_error) const;
+
+            /** 
+             * @brief add the observations to the smoother of the agent,
+             * false when the window is not filled past observation_limit
+            **/
+            bool gtsam_pose_optimization(
+                const factor_graph &fact, Eigen::Affine3d &pose, size_t index);
     };
 }
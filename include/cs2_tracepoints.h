@@ -0,0 +1,63 @@
+/*
+* cs2_tracepoints.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+// LTTng-UST provider of the pose to command path, the events carry the
+// agent index and the sequence of the pose, so that a pose can be followed
+// through planning into the command sent for it. Included through tracing.h
+// only, the provider is read more than once hence the guard below.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER cs2
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "cs2_tracepoints.h"
+
+#if !defined(CS2_TRACEPOINTS_H) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define CS2_TRACEPOINTS_H
+
+#include <stdint.h>
+#include <lttng/tracepoint.h>
+
+// a pose went into the agent seqlock, stamp is the source stamp in ns
+TRACEPOINT_EVENT(cs2, pose_ingested,
+    TP_ARGS(uint32_t, agent, uint64_t, sequence, int64_t, stamp),
+    TP_FIELDS(
+        ctf_integer(uint32_t, agent, agent)
+        ctf_integer(uint64_t, sequence, sequence)
+        ctf_integer(int64_t, stamp, stamp)))
+
+// orca planned the velocity of the agent from the pose
+TRACEPOINT_EVENT(cs2, agent_planned,
+    TP_ARGS(uint32_t, agent, uint64_t, sequence),
+    TP_FIELDS(
+        ctf_integer(uint32_t, agent, agent)
+        ctf_integer(uint64_t, sequence, sequence)))
+
+// the command planned from the pose was published, latency is the ros
+// time from the source stamp to the publish in ns
+TRACEPOINT_EVENT(cs2, command_published,
+    TP_ARGS(uint32_t, agent, uint64_t, sequence, int64_t, stamp, int64_t, latency),
+    TP_FIELDS(
+        ctf_integer(uint32_t, agent, agent)
+        ctf_integer(uint64_t, sequence, sequence)
+        ctf_integer(int64_t, stamp, stamp)
+        ctf_integer(int64_t, latency, latency)))
+
+#endif
+
+#include <lttng/tracepoint-event.h>
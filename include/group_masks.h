@@ -0,0 +1,86 @@
+/*
+* group_masks.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+
+#ifndef GROUP_MASKS_H
+#define GROUP_MASKS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace common
+{
+    /**
+     * @brief group masks last sent to the crazyflies, so that a command
+     * for several agents goes out as one broadcast on a group bit. The bit
+     * whose members are closest to the agents of the command is picked,
+     * only the agents that join or leave it get a new mask. A command sent
+     * to the same agents again needs no mask change at all. A mask is only
+     * known once the crazyflie acknowledged it, an agent whose mask is not
+     * known is always sent one, in the group or out of every group.
+    **/
+    class group_masks
+    {
+        public:
+
+            /** @brief group bits of the crazyflie firmware **/
+            static constexpr size_t groups = 8;
+
+            /** @brief no mask is known, a crazyflie keeps its mask between runs **/
+            explicit group_masks(size_t agents) : masks(agents, 0), known(agents, 0) {}
+
+            /** 
+             * @brief group bit for exactly these agents, with the agents
+             * whose mask has to change and their new mask. Changes nothing
+            **/
+            size_t select(const std::vector<size_t> &members,
+                std::vector<std::pair<size_t, uint8_t>> &changes) const;
+
+            /** @brief the group bit was picked, it goes last on the next tie **/
+            void use(size_t group) { last_used[group] = ++tick; }
+
+            /** @brief the agent acknowledged its new mask **/
+            void set(size_t agent, uint8_t mask) 
+            {
+                masks[agent] = mask;
+                known[agent] = 1;
+            }
+
+            /** @brief the agent may or may not have taken a mask sent to it **/
+            void forget(size_t agent) { known[agent] = 0; }
+
+            uint8_t mask(size_t agent) const { return masks[agent]; }
+
+            /** @brief broadcast mask of a group bit **/
+            static uint8_t group_mask(size_t group) { return (uint8_t)(1u << group); }
+
+        private:
+
+            // 0 is the firmware default, the agent is in no group
+            std::vector<uint8_t> masks;
+            std::vector<uint8_t> known;
+            // when each bit was last picked, the oldest goes first on a tie
+            std::array<uint64_t, groups> last_used = {};
+            uint64_t tick = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+* headless_sim.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef HEADLESS_SIM_H
+#define HEADLESS_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "swarm_planner.h"
+
+namespace common
+{
+    enum sim_scenario
+    {
+        CIRCLE_SWAP, // agents on a circle fly to the opposite side
+        CORRIDOR, // two groups swap ends of a walled corridor
+        RANDOM_GOALS // every agent gets a new random goal when it arrives
+    };
+
+    struct sim_config
+    {
+        sim_scenario scenario = CIRCLE_SWAP;
+        size_t agents = 10;
+        uint32_t seed = 1;
+        size_t max_ticks = 1000;
+        double reached_threshold = 0.1;
+        // same meaning as trajectory_parameters in the config
+        planner_parameters planner = {
+            0.1, 10, 1.0, 1.5, 0.2, 1.0, {0.0, 3.0}, 1};
+    };
+
+    struct sim_result
+    {
+        size_t ticks = 0;
+        size_t arrived = 0;
+        // random goals reached, its agents never all arrive
+        size_t goals_reached = 0;
+        // planning time of one tick in milliseconds
+        double latency_p50 = 0.0;
+        double latency_p90 = 0.0;
+        double latency_p99 = 0.0;
+        double latency_max = 0.0;
+        // ticks summed over every pair overlapping their protected zones
+        size_t collisions = 0;
+        // closest pair within twice the protected zone, infinity if none
+        double min_separation = 0.0;
+        double agent_ticks_per_second = 0.0;
+    };
+
+    /**
+     * @brief headless and deterministic swarm simulation around the
+     * swarm_planner, the agents fly the commanded velocity exactly.
+     * The targets are followed the same way as MOVE_VELOCITY in the
+     * handler, except that the approach inside max_velocity of the goal is
+     * planned as well. The handler flies it straight, the collisions
+     * counted would then be of the final approach and not of the planner.
+    **/
+    class headless_sim
+    {
+        public:
+
+            explicit headless_sim(const sim_config &configuration);
+
+            /** @brief one planning tick, returns the planning time in seconds **/
+            double step();
+
+            /** @brief steps until every agent arrived or max_ticks **/
+            sim_result run();
+
+            const std::vector<Eigen::Vector3d> &positions() const {return position;}
+
+            static std::string scenario_name(sim_scenario scenario);
+
+        private:
+
+            sim_config config;
+            swarm_planner planner;
+            std::mt19937 generator;
+
+            std::vector<Eigen::Vector3d> position;
+            std::vector<Eigen::Vector3d> velocity;
+            std::vector<Eigen::Vector3d> goal;
+            std::vector<uint8_t> reached;
+            size_t goals_reached = 0;
+
+            std::vector<velocity_command> velocity_commands;
+
+            // for counting collisions
+            spatial_grid collision_grid;
+            std::vector<Eigen::Vector3f> collision_points;
+
+            // bounds of the random goals
+            Eigen::Vector3d random_min;
+            Eigen::Vector3d random_max;
+
+            void setup_circle_swap();
+            void setup_corridor();
+            void setup_random_goals();
+
+            /**
+             * @brief random point at least twice the protected zone from
+             * the points of apart, other than the one at skip
+            **/
+            Eigen::Vector3d random_point(
+                const std::vector<Eigen::Vector3d> &apart, size_t skip);
+
+            size_t count_collisions(double &min_separation);
+    };
+}
+
+#endif
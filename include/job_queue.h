@@ -0,0 +1,70 @@
+/*
+* job_queue.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+    /**
+     * @brief fixed set of worker threads that run posted jobs in the order
+     * they were posted, post returns at once. Unlike the worker_pool the
+     * caller does not wait, hence this is meant for long jobs such as the
+     * relocalization solves. Jobs still queued at destruction are dropped,
+     * running ones are finished.
+    **/
+    class job_queue
+    {
+        public:
+
+            explicit job_queue(size_t thread_count);
+
+            ~job_queue();
+
+            job_queue(const job_queue &) = delete;
+            job_queue &operator=(const job_queue &) = delete;
+
+            void post(std::function<void()> job);
+
+            /** @brief jobs waiting and running **/
+            size_t depth() const;
+
+        private:
+
+            std::vector<std::thread> workers;
+
+            mutable std::mutex mutex;
+            std::condition_variable cv;
+
+            std::deque<std::function<void()>> jobs;
+            size_t running = 0;
+            bool stop = false;
+
+            void worker_loop();
+    };
+}
+
+#endif
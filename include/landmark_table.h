@@ -0,0 +1,76 @@
+/*
+* landmark_table.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef LANDMARK_TABLE_H
+#define LANDMARK_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+
+namespace common
+{
+    /** @brief relocalization tag, everything the factor graph needs of it **/
+    struct landmark
+    {
+        int id;
+        // world -> tag
+        Eigen::Affine3d world_to_tag;
+        gtsam::Pose3 prior;
+        gtsam::SharedNoiseModel prior_noise;
+    };
+
+    /**
+     * @brief relocalization tags indexed by their tag id, filled once from
+     * the april_tags parameters. The lookup is an array access, tag ids
+     * are small hence the index is sized to the largest one.
+    **/
+    class landmark_table
+    {
+        public:
+
+            /** @brief ids above this are rejected **/
+            static constexpr int max_id = (1 << 20) - 1;
+
+            /** @brief false if the id is out of range or already added **/
+            bool add(int id, const Eigen::Affine3d &world_to_tag,
+                const gtsam::SharedNoiseModel &prior_noise);
+
+            /** @brief nullptr if the id is not a relocalization tag **/
+            const landmark *find(int id) const
+            {
+                if (id < 0 || (size_t)id >= slots.size() || slots[id] < 0)
+                    return nullptr;
+                return &entries[slots[id]];
+            }
+
+            size_t size() const { return entries.size(); }
+
+        private:
+
+            // tag id -> entry, -1 for the ids that are not landmarks
+            std::vector<int32_t> slots;
+            std::vector<landmark> entries;
+    };
+}
+
+#endif
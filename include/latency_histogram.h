@@ -0,0 +1,99 @@
+/*
+* latency_histogram.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace common
+{
+    /**
+     * @brief latency counts in fixed log linear buckets, 4 to every power
+     * of two of nanoseconds so a bucket is within 25% of its values.
+     * Recording is two relaxed atomic adds and can come from any thread,
+     * collect takes the counts out and reports the percentiles.
+    **/
+    class latency_histogram
+    {
+        public:
+
+            struct summary
+            {
+                uint64_t count;
+                // milliseconds, the upper bound of the bucket of the percentile
+                double p50;
+                double p90;
+                double p99;
+                double max;
+            };
+
+            latency_histogram();
+
+            latency_histogram(const latency_histogram &) = delete;
+            latency_histogram &operator=(const latency_histogram &) = delete;
+
+            void record(int64_t nanoseconds);
+
+            /** @brief percentiles since the last collect, the counts start over **/
+            summary collect();
+
+        private:
+
+            static constexpr size_t sub_buckets = 4;
+            // up to 2^40ns, about 18 minutes
+            static constexpr size_t max_exponent = 40;
+            static constexpr size_t bucket_count = 
+                sub_buckets + (max_exponent - 2) * sub_buckets;
+
+            std::atomic<uint64_t> buckets[bucket_count];
+            std::atomic<uint64_t> max_value{0};
+
+            static size_t bucket_of(uint64_t value);
+            static uint64_t upper_bound(size_t bucket);
+    };
+
+    /** @brief records the time from its construction to its destruction **/
+    class scoped_latency
+    {
+        public:
+
+            explicit scoped_latency(latency_histogram &histogram) :
+                histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+            ~scoped_latency()
+            {
+                histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+            }
+
+            scoped_latency(const scoped_latency &) = delete;
+            scoped_latency &operator=(const scoped_latency &) = delete;
+
+        private:
+
+            latency_histogram &histogram;
+            std::chrono::steady_clock::time_point start;
+    };
+}
+
+#endif
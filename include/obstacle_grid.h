@@ -0,0 +1,82 @@
+/*
+* obstacle_grid.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef OBSTACLE_GRID_H
+#define OBSTACLE_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace common
+{
+    /**
+     * @brief static 2d grid over the obstacle segments of the environment,
+     * built once at start up. Every segment is stored in each cell that is
+     * within range of it, hence a query reads the one cell under the query
+     * point and the cost does not grow with the total number of segments.
+     * The candidates can still be further than the range and should be
+     * checked by the caller.
+    **/
+    class obstacle_grid
+    {
+        public:
+
+            obstacle_grid() : cell_size(1.0f), columns(0), rows(0) {}
+
+            /** @brief segments are (start, end) in the xy plane **/
+            void build(
+                const std::vector<std::pair<Eigen::Vector2f, Eigen::Vector2f>> &segments,
+                float range);
+
+            /** @brief calls visit(index) for every segment that may be in range of p **/
+            template <typename Visitor>
+            void for_each_candidate(const Eigen::Vector3f &p, Visitor &&visit) const
+            {
+                if (cell_start.empty())
+                    return;
+
+                int x = (int)std::floor((p.x() - origin.x()) / cell_size);
+                int y = (int)std::floor((p.y() - origin.y()) / cell_size);
+                // outside of the grid nothing is in range
+                if (x < 0 || y < 0 || x >= columns || y >= rows)
+                    return;
+
+                size_t c = (size_t)y * (size_t)columns + (size_t)x;
+                for (uint32_t e = cell_start[c]; e < cell_start[c+1]; e++)
+                    visit((size_t)entries[e]);
+            }
+
+        private:
+
+            float cell_size;
+            Eigen::Vector2f origin;
+            int columns;
+            int rows;
+
+            // cell c holds entries[cell_start[c], cell_start[c+1])
+            std::vector<uint32_t> cell_start;
+            std::vector<uint32_t> entries;
+    };
+}
+
+#endif
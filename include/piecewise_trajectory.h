@@ -0,0 +1,79 @@
+/*
+* piecewise_trajectory.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+
+#ifndef PIECEWISE_TRAJECTORY_H
+#define PIECEWISE_TRAJECTORY_H
+
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace common
+{
+    /** 
+     * @brief one piece in the layout of the crazyflie high level commander,
+     * p(t) = sum c[k] t^k for t in [0, duration]
+    **/
+    struct polynomial_piece
+    {
+        static constexpr size_t coefficients = 8;
+
+        double duration;
+        double x[coefficients];
+        double y[coefficients];
+        double z[coefficients];
+        double yaw[coefficients];
+    };
+
+    /**
+     * @brief trajectory through the targets of an agent that is uploaded
+     * once and flown onboard. Every piece is a straight rest to rest
+     * segment with the septic smoothstep, continuous up to the jerk, and
+     * timed so that its peak velocity is the maximum velocity.
+    **/
+    class piecewise_trajectory
+    {
+        public:
+
+            piecewise_trajectory() = default;
+
+            piecewise_trajectory(const Eigen::Vector3d &start, 
+                const std::vector<Eigen::Vector3d> &waypoints, 
+                double max_velocity, double yaw);
+
+            const std::vector<polynomial_piece> &pieces() const { return segments; }
+
+            double duration() const;
+
+            /** @brief before the start it is the start, after the end the last waypoint **/
+            Eigen::Vector3d position(double t) const;
+
+            Eigen::Vector3d velocity(double t) const;
+
+        private:
+
+            std::vector<polynomial_piece> segments;
+
+            /** @brief piece at t, t is made relative to it **/
+            const polynomial_piece *find(double &t) const;
+    };
+}
+
+#endif
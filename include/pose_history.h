@@ -0,0 +1,80 @@
+/*
+* pose_history.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef POSE_HISTORY_H
+#define POSE_HISTORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common.h"
+#include "seqlock.h"
+
+namespace common
+{
+    /**
+     * @brief fixed capacity ring of the latest poses of one agent, ordered
+     * by their stamp. The pose callback appends and readers look a stamp up
+     * with a binary search, every slot is a seqlock so that readers never
+     * block the writer and never take a lock. A slot that is overwritten
+     * while it is read is taken as older than the rest of the ring.
+    **/
+    class pose_history
+    {
+        public:
+
+            explicit pose_history(size_t capacity);
+
+            pose_history(const pose_history &) = delete;
+            pose_history &operator=(const pose_history &) = delete;
+
+            /** @brief samples older than the newest one are dropped **/
+            void push(const pose_sample &sample);
+
+            /**
+             * @brief pose at the stamp, interpolated between the samples
+             * around it, position is lerped and orientation slerped. Returns
+             * false if the closest sample is more than tolerance away
+            **/
+            bool sample_at(int64_t stamp, int64_t tolerance,
+                pose_sample &result) const;
+
+        private:
+
+            struct entry
+            {
+                // number of the push, tells an overwritten slot apart
+                uint64_t sequence;
+                pose_sample pose;
+            };
+
+            size_t capacity;
+            std::unique_ptr<seqlock<entry>[]> slots;
+
+            // pushes so far, only advanced once the slot is written
+            std::atomic<uint64_t> head{0};
+            int64_t newest_stamp = INT64_MIN;
+            // pose callbacks of one agent may overlap in the reentrant group
+            std::atomic_flag writing = ATOMIC_FLAG_INIT;
+
+            bool read(uint64_t sequence, entry &e) const;
+    };
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+* pose_smoother.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef POSE_SMOOTHER_H
+#define POSE_SMOOTHER_H
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+
+#include "landmark_table.h"
+
+namespace common
+{
+    /** @brief one X state, the agent pose when a set of tags was seen **/
+    struct smoother_state
+    {
+        // pose of the agent from the pose topic
+        gtsam::Pose3 recorded;
+        // pose back tracked from the first tag, the linearization point
+        gtsam::Pose3 initial;
+        // landmark and body -> tag measurement of every tag, the landmark
+        // table outlives the smoother
+        std::vector<std::pair<const landmark *, gtsam::Pose3>> landmarks;
+    };
+
+    /**
+     * @brief incremental relocalization graph of one agent, X states are
+     * chained by the between factors and every tag adds a Z with its prior.
+     * Only the new factors go into iSAM2, once the window holds twice its
+     * size the older half is marginalized into a prior on the newest
+     * dropped state and iSAM2 starts over from the rest, which keeps the
+     * memory bounded and the cost per state constant. Not thread safe, the
+     * relocalization jobs of one agent do not overlap.
+    **/
+    class pose_smoother
+    {
+        public:
+
+            pose_smoother(size_t window, double sigma);
+
+            /** @brief add the states in order, each after the last one **/
+            void update(const std::vector<smoother_state> &states);
+
+            /** @brief states in the window **/
+            size_t size() const { return entries.size(); }
+
+            /**
+             * @brief average error of the smoothed poses against the
+             * recorded ones, of the states added since the last correction,
+             * the earlier ones are already in the pose. False when there
+             * are none
+            **/
+            bool correction(Eigen::Vector3d &translation,
+                Eigen::Quaterniond &rotation);
+
+        private:
+
+            struct entry
+            {
+                size_t x;
+                gtsam::Pose3 recorded;
+                std::vector<gtsam::Key> landmark_keys;
+                // tag factors, and the between factor from the state before
+                gtsam::NonlinearFactorGraph factors;
+                gtsam::NonlinearFactorGraph odometry;
+            };
+
+            size_t window;
+            gtsam::SharedNoiseModel noise;
+
+            gtsam::ISAM2 isam;
+            std::deque<entry> entries;
+
+            // marginal of the states dropped so far
+            gtsam::NonlinearFactorGraph anchor;
+            bool has_anchor = false;
+            size_t anchor_x = 0;
+
+            size_t next_x = 0;
+            size_t next_z = 0;
+            // first state that is not in a correction yet
+            size_t corrected_x = 0;
+            bool has_previous = false;
+            gtsam::Pose3 previous_initial;
+
+            void marginalize();
+    };
+}
+
+#endif
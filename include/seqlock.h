@@ -0,0 +1,104 @@
+/*
+* seqlock.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace common
+{
+    /**
+     * @brief sequence lock holding one trivially copyable value.
+     * The writer bumps the sequence to odd, writes, then bumps it to even,
+     * readers retry if the sequence was odd or changed during their copy.
+     * Readers never block the writer, and the value is kept in atomic words
+     * so that a torn copy is discarded instead of being undefined.
+    **/
+    template <typename T>
+    class seqlock
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "seqlock value has to be trivially copyable");
+
+        public:
+
+            seqlock()
+            {
+                for (auto &w : words)
+                    w.store(0, std::memory_order_relaxed);
+            }
+
+            seqlock(const seqlock &) = delete;
+            seqlock &operator=(const seqlock &) = delete;
+
+            void store(const T &value)
+            {
+                uint64_t buffer[word_count] = {};
+                std::memcpy(buffer, &value, sizeof(T));
+
+                // claim the writer slot, concurrent writers of the same value spin here
+                uint32_t s = sequence.load(std::memory_order_relaxed);
+                while ((s & 1u) || !sequence.compare_exchange_weak(
+                    s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    s = sequence.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                for (size_t i = 0; i < word_count; i++)
+                    words[i].store(buffer[i], std::memory_order_relaxed);
+
+                sequence.store(s + 2, std::memory_order_release);
+            }
+
+            T load() const
+            {
+                uint64_t buffer[word_count];
+                uint32_t before, after;
+                do
+                {
+                    before = sequence.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < word_count; i++)
+                        buffer[i] = words[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    after = sequence.load(std::memory_order_relaxed);
+                } while ((before & 1u) || before != after);
+
+                T value;
+                std::memcpy(&value, buffer, sizeof(T));
+                return value;
+            }
+
+            /** @brief number of completed writes **/
+            uint32_t version() const
+            {
+                return sequence.load(std::memory_order_acquire) >> 1;
+            }
+
+        private:
+
+            static constexpr size_t word_count = (sizeof(T) + 7) / 8;
+
+            std::atomic<uint32_t> sequence{0};
+            std::atomic<uint64_t> words[word_count];
+    };
+}
+
+#endif
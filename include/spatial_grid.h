@@ -0,0 +1,157 @@
+/*
+* spatial_grid.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace common
+{
+    /**
+     * @brief uniform hash grid used for the neighbour queries of the swarm,
+     * the cell size should be the communication radius so that a range query
+     * only visits the 27 cells around the query point.
+     * The grid is rebuilt once per planning tick and the storage is reused,
+     * hence after the first rebuild there are no more allocations.
+     * Queries are const and can be called from several threads at once.
+    **/
+    class spatial_grid
+    {
+        public:
+
+            spatial_grid() : cell_size(1.0f), inv_cell_size(1.0f), bucket_mask(0) {}
+
+            void set_cell_size(float size);
+
+            /** @brief preallocate the pools for n points **/
+            void reserve(size_t n);
+
+            /** @brief counting sort the points into their buckets **/
+            void rebuild(const std::vector<Eigen::Vector3f> &points);
+
+            size_t size() const {return entries.size();}
+
+            /**
+             * @brief calls visit(index, distance_squared) for every point that is
+             * within the radius of p, the point with index "exclude" is skipped
+            **/
+            template <typename Visitor>
+            void for_each_in_range(
+                const Eigen::Vector3f &p, float radius,
+                size_t exclude, Visitor &&visit) const
+            {
+                if (entries.empty())
+                    return;
+
+                const float radius_sq = radius * radius;
+                int lo[3], hi[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    lo[k] = cell_of(p[k] - radius);
+                    hi[k] = cell_of(p[k] + radius);
+                }
+
+                size_t cells = (size_t)(hi[0] - lo[0] + 1) *
+                    (size_t)(hi[1] - lo[1] + 1) * (size_t)(hi[2] - lo[2] + 1);
+
+                // too many cells for the bucket table, checking every entry is cheaper
+                if (cells > max_visited_buckets || cells > bucket_mask + 1)
+                {
+                    for (const auto &e : entries)
+                        visit_entry(e, p, radius_sq, exclude, visit);
+                    return;
+                }
+
+                // different cells can hash into the same bucket, visit each bucket once
+                uint32_t visited[max_visited_buckets];
+                size_t visited_size = 0;
+
+                for (int x = lo[0]; x <= hi[0]; x++)
+                    for (int y = lo[1]; y <= hi[1]; y++)
+                        for (int z = lo[2]; z <= hi[2]; z++)
+                        {
+                            uint32_t b = hash(x, y, z);
+                            bool seen = false;
+                            for (size_t v = 0; v < visited_size && !seen; v++)
+                                seen = visited[v] == b;
+                            if (seen)
+                                continue;
+                            visited[visited_size++] = b;
+
+                            for (uint32_t e = bucket_start[b]; e < bucket_start[b+1]; e++)
+                                visit_entry(entries[e], p, radius_sq, exclude, visit);
+                        }
+            }
+
+            /** @brief collects the indices within the radius of p into result **/
+            void query_range(
+                const Eigen::Vector3f &p, float radius,
+                size_t exclude, std::vector<size_t> &result) const;
+
+        private:
+
+            struct entry
+            {
+                Eigen::Vector3f position;
+                uint32_t index;
+            };
+
+            static constexpr size_t max_visited_buckets = 64;
+
+            float cell_size;
+            float inv_cell_size;
+            size_t bucket_mask;
+
+            // bucket b holds entries[bucket_start[b], bucket_start[b+1])
+            std::vector<uint32_t> bucket_start;
+            std::vector<entry> entries;
+            std::vector<uint32_t> entry_bucket;
+
+            int cell_of(float v) const
+            {
+                return (int)std::floor(v * inv_cell_size);
+            }
+
+            uint32_t hash(int x, int y, int z) const
+            {
+                return (((uint32_t)x * 73856093u) ^
+                    ((uint32_t)y * 19349663u) ^
+                    ((uint32_t)z * 83492791u)) & (uint32_t)bucket_mask;
+            }
+
+            template <typename Visitor>
+            static void visit_entry(
+                const entry &e, const Eigen::Vector3f &p, float radius_sq,
+                size_t exclude, Visitor &visit)
+            {
+                if (e.index == exclude)
+                    return;
+                float dist_sq = (e.position - p).squaredNorm();
+                if (dist_sq <= radius_sq)
+                    visit((size_t)e.index, dist_sq);
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+* spsc_ring.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "seqlock.h"
+
+namespace common
+{
+    enum class overflow_policy
+    {
+        // a full ring rejects the new value
+        drop_newest,
+        // a full ring replaces its oldest value
+        overwrite_oldest
+    };
+
+    /**
+     * @brief bounded ring with one producer and one consumer, neither takes
+     * a lock. Every slot is a seqlock tagged with its push number, hence
+     * with overwrite_oldest the consumer can tell the slots the producer
+     * lapped apart, those are counted as dropped like the rejected ones
+     * with drop_newest.
+    **/
+    template <typename T>
+    class spsc_ring
+    {
+        public:
+
+            spsc_ring(size_t capacity, overflow_policy policy) :
+                capacity(std::max(capacity, (size_t)1)), policy(policy),
+                slots(new seqlock<entry>[std::max(capacity, (size_t)1)]) {}
+
+            spsc_ring(const spsc_ring &) = delete;
+            spsc_ring &operator=(const spsc_ring &) = delete;
+
+            /** @brief producer side, false if the value was dropped **/
+            bool push(const T &value)
+            {
+                uint64_t h = head.load(std::memory_order_relaxed);
+                if (policy == overflow_policy::drop_newest &&
+                    h - tail.load(std::memory_order_acquire) >= capacity)
+                {
+                    drops.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                slots[h % capacity].store({h, value});
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             * @brief consumer side, visits every value pushed since the
+             * last drain in order and returns how many were visited
+            **/
+            template <typename Visitor>
+            size_t drain(Visitor &&visit)
+            {
+                uint64_t h = head.load(std::memory_order_acquire);
+                uint64_t t = tail.load(std::memory_order_relaxed);
+
+                if (h - t > capacity)
+                {
+                    drops.fetch_add(h - t - capacity, std::memory_order_relaxed);
+                    t = h - capacity;
+                }
+
+                size_t visited = 0;
+                for (; t < h; t++)
+                {
+                    entry e = slots[t % capacity].load();
+                    // lapped while this was read
+                    if (e.sequence != t)
+                    {
+                        drops.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    visit(e.value);
+                    visited++;
+                }
+
+                tail.store(h, std::memory_order_release);
+                return visited;
+            }
+
+            /** @brief values dropped since construction **/
+            uint64_t dropped() const
+            {
+                return drops.load(std::memory_order_relaxed);
+            }
+
+        private:
+
+            struct entry
+            {
+                uint64_t sequence;
+                T value;
+            };
+
+            size_t capacity;
+            overflow_policy policy;
+            std::unique_ptr<seqlock<entry>[]> slots;
+
+            std::atomic<uint64_t> head{0};
+            std::atomic<uint64_t> tail{0};
+            std::atomic<uint64_t> drops{0};
+    };
+}
+
+#endif
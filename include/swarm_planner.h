@@ -0,0 +1,134 @@
+/*
+* swarm_planner.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef SWARM_PLANNER_H
+#define SWARM_PLANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "agent.h"
+#include "spatial_grid.h"
+#include "obstacle_grid.h"
+#include "worker_pool.h"
+
+namespace common
+{
+    /** @brief the pose sample a command was planned from **/
+    struct command_trace
+    {
+        // source stamp of the pose in ns, 0 if the agent has no pose yet
+        int64_t stamp = 0;
+        uint64_t sequence = 0;
+        // steady clock time the pose was ingested in ns
+        int64_t received = 0;
+    };
+
+    /** 
+     * @brief velocity command of one agent, the state machine fills 
+     * these in and they are sent together after the planning stage
+    **/
+    struct velocity_command
+    {
+        size_t index;
+        Eigen::Vector3d velocity;
+        double height;
+        bool plan;
+        // filled in from the snapshot before planning
+        command_trace trace = {};
+    };
+
+    struct planner_parameters
+    {
+        double time_step;
+        size_t max_neighbours;
+        double max_velocity;
+        double communication_radius;
+        double protected_zone;
+        double time_horizon;
+        std::pair<double, double> height_range;
+        size_t threads;
+    };
+
+    /**
+     * @brief ORCA planning of the whole swarm without any ROS dependency,
+     * used by cs2_application and by the headless simulator.
+     * Every tick the states are set, the neighbour index is rebuilt and
+     * then every command plans against that same snapshot.
+    **/
+    class swarm_planner
+    {
+        public:
+
+            explicit swarm_planner(const planner_parameters &parameters);
+
+            /** @brief adds an agent, the returned index is used by the commands **/
+            size_t add_agent(size_t id);
+
+            size_t size() const {return rvo_agents.size();}
+
+            const planner_parameters &parameters() const {return param;}
+
+            /** @brief static walls, the index is built here once **/
+            void set_obstacles(const std::vector<RVO::Eval_obstacle> &walls);
+
+            /** @brief state of an agent for the next rebuild **/
+            void set_state(size_t index, 
+                const Eigen::Vector3d &position, const Eigen::Vector3d &velocity);
+
+            /** @brief snapshot the states set into one neighbour index **/
+            void rebuild_neighbour_index();
+
+            /** @brief replaces the velocity of the commands that have plan set **/
+            void plan(std::vector<velocity_command> &commands);
+
+            void conduct_planning(velocity_command &command);
+
+            /** 
+             * @brief distance to the closest other agent in the neighbour
+             * index, the communication radius if none is within it
+            **/
+            double nearest_neighbour(size_t index) const;
+
+        private:
+
+            planner_parameters param;
+
+            std::vector<RVO::Agent> rvo_agents;
+
+            // static walls of the environment and their index, built once
+            double obstacle_range;
+            obstacle_grid obstacle_walls;
+            std::vector<RVO::Eval_obstacle> obstacle_pool;
+
+            // neighbour index shared by all agents in a planning tick
+            spatial_grid neighbour_grid;
+            std::vector<RVO::Eval_agent> neighbour_pool;
+            std::vector<Eigen::Vector3f> neighbour_points;
+
+            // ORCA solves of one tick are split between these threads
+            std::unique_ptr<worker_pool> planning_pool;
+    };
+}
+
+#endif
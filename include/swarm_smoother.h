@@ -0,0 +1,114 @@
+/*
+* swarm_smoother.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef SWARM_SMOOTHER_H
+#define SWARM_SMOOTHER_H
+
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+
+#include "landmark_table.h"
+#include "pose_smoother.h"
+
+namespace common
+{
+    /**
+     * @brief one relocalization graph for the whole swarm. Every agent has
+     * its own chain of X states, a tag is one landmark shared by all the
+     * agents that see it, so a tag seen by several agents ties their
+     * corrections together. The landmarks are eliminated last, each chain
+     * is then eliminated into the landmarks without fill in between the
+     * chains. The window works as in pose_smoother, per chain, except that
+     * the dropped states are marginalized jointly onto the newest dropped
+     * state of every chain and the landmarks that stay, so what they told
+     * about the landmarks is kept without counting the landmark priors
+     * twice. Not thread safe.
+    **/
+    class swarm_smoother
+    {
+        public:
+
+            swarm_smoother(size_t agents, size_t window, double sigma);
+
+            /** @brief add the states of the agents, in order per agent **/
+            void update(const std::vector<std::pair<size_t, smoother_state>> &states);
+
+            /** @brief states of the agent in the window **/
+            size_t size(size_t agent) const { return chains[agent].entries.size(); }
+
+            /** @brief as pose_smoother::correction, for one agent **/
+            bool correction(size_t agent, Eigen::Vector3d &translation,
+                Eigen::Quaterniond &rotation);
+
+        private:
+
+            struct entry
+            {
+                size_t x;
+                gtsam::Pose3 recorded;
+                std::vector<int> landmark_ids;
+                // tag factors, and the between factor from the state before
+                gtsam::NonlinearFactorGraph factors;
+                gtsam::NonlinearFactorGraph odometry;
+            };
+
+            struct chain
+            {
+                std::deque<entry> entries;
+                // newest dropped state, in the anchor of the smoother
+                bool has_anchor = false;
+                size_t anchor_x = 0;
+                size_t next_x = 0;
+                // first state that is not in a correction yet
+                size_t corrected_x = 0;
+                bool has_previous = false;
+                gtsam::Pose3 previous_initial;
+            };
+
+            size_t window;
+            gtsam::SharedNoiseModel noise;
+
+            gtsam::ISAM2 isam;
+            std::vector<chain> chains;
+
+            // marginal of the states dropped so far, on the anchor state of
+            // every chain and the landmarks they saw that are still active
+            gtsam::NonlinearFactorGraph anchor;
+
+            // landmarks in the graph, with the states that see them
+            std::unordered_map<int, std::pair<const landmark *, size_t>> active;
+
+            gtsam::Key state_key(size_t agent, size_t x) const;
+
+            void marginalize();
+
+            /** @brief landmarks constrained to be eliminated last **/
+            gtsam::ISAM2UpdateParams update_params() const;
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+* tracing.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef TRACING_H
+#define TRACING_H
+
+/**
+ * @brief CS2_TRACEPOINT(event, args...) fires an event of the cs2 LTTng
+ * provider in cs2_tracepoints.h when built with -DCS2_TRACING=ON, else it
+ * compiles to nothing and the arguments are not evaluated
+**/
+#ifdef CS2_TRACING
+#include "cs2_tracepoints.h"
+#define CS2_TRACEPOINT(event, ...) tracepoint(cs2, event, __VA_ARGS__)
+#else
+#define CS2_TRACEPOINT(event, ...) ((void)0)
+#endif
+
+#endif
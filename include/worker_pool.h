@@ -0,0 +1,104 @@
+/*
+* worker_pool.h
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+    /**
+     * @brief fixed set of worker threads that split a loop between them,
+     * the calling thread joins in so a pool of size 1 runs everything inline.
+     * Items are handed out one at a time from a shared counter, hence a slow
+     * item does not hold up the rest. Each item should only write to its own
+     * slot so that the result does not depend on which thread ran it.
+    **/
+    class worker_pool
+    {
+        public:
+
+            explicit worker_pool(size_t thread_count);
+
+            ~worker_pool();
+
+            worker_pool(const worker_pool &) = delete;
+            worker_pool &operator=(const worker_pool &) = delete;
+
+            size_t size() const {return workers.size() + 1;}
+
+            /** @brief calls f(i) for i in [0, n) and returns when all are done **/
+            template <typename F>
+            void parallel_for(size_t n, F &&f)
+            {
+                if (workers.empty() || n <= 1)
+                {
+                    for (size_t i = 0; i < n; i++)
+                        f(i);
+                    return;
+                }
+
+                std::lock_guard<std::mutex> dispatch_lock(dispatch_mutex);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job = [&f](size_t i) { f(i); };
+                    job_size = n;
+                    next.store(0);
+                    pending = workers.size();
+                    generation++;
+                }
+                start_cv.notify_all();
+
+                run_job();
+
+                std::unique_lock<std::mutex> lock(mutex);
+                done_cv.wait(lock, [this] { return pending == 0; });
+                job = nullptr;
+            }
+
+        private:
+
+            std::vector<std::thread> workers;
+
+            std::mutex dispatch_mutex;
+            std::mutex mutex;
+            std::condition_variable start_cv;
+            std::condition_variable done_cv;
+
+            std::function<void(size_t)> job;
+            size_t job_size = 0;
+            std::atomic<size_t> next{0};
+            size_t pending = 0;
+            uint64_t generation = 0;
+            bool stop = false;
+
+            void run_job();
+
+            void worker_loop();
+    };
+}
+
+#endif
@@ -0,0 +1,102 @@
+import os
+import yaml
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, OpaqueFunction
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
+
+
+# all the nodes in one process, messages between them are passed
+# intra-process without serialization
+def launch_setup(context, *args, **kwargs):
+    # load crazyflies
+    crazyflies_yaml = os.path.join(
+        get_package_share_directory('crazyflie'),
+        'config',
+        'crazyflies.yaml')
+
+    with open(crazyflies_yaml, 'r') as ymlfile:
+        crazyflies = yaml.safe_load(ymlfile)
+
+    # load swarm_manager parameters + load april tags configuration
+    config_yaml = os.path.join(
+        get_package_share_directory('crazyswarm_application'),
+        'launch',
+        'config.yaml')
+
+    with open(config_yaml, 'r') as ymlfile:
+        config = yaml.safe_load(ymlfile)
+
+    mesh_path = os.path.join(
+        get_package_share_directory('crazyswarm_application'),
+        'meshes',
+        'master.dae')
+
+    intra_process = [{'use_intra_process_comms': True}]
+
+    nodes = [
+        ComposableNode(
+            package='crazyswarm_application',
+            plugin='cs2::cs2_application',
+            name='crazyswarm_application_node',
+            parameters=[crazyflies, config],
+            extra_arguments=intra_process
+        ),
+        ComposableNode(
+            package='crazyswarm_application',
+            plugin='RvizVisualizer',
+            name='visualization_node',
+            parameters=[config, {'mesh_path': mesh_path}],
+            extra_arguments=intra_process
+        ),
+    ]
+
+    if LaunchConfiguration('sim').perform(context) == 'true':
+        nodes.append(ComposableNode(
+            package='crazyswarm_application',
+            plugin='AprilDectectionProxy',
+            name='april_detection_proxy_node',
+            parameters=[crazyflies, config],
+            extra_arguments=intra_process
+        ))
+
+    # the mission file name in launch/mission, no mission if left empty
+    mission_file = LaunchConfiguration('mission').perform(context)
+    if mission_file:
+        mission_yaml = os.path.join(
+            get_package_share_directory('crazyswarm_application'),
+            'launch', 'mission', mission_file)
+
+        with open(mission_yaml, 'r') as ymlfile:
+            mission = yaml.safe_load(ymlfile)
+
+        # the container keeps running the other nodes after the mission
+        nodes.append(ComposableNode(
+            package='crazyswarm_application',
+            plugin='mission_handler',
+            name='mission_node',
+            parameters=[crazyflies, config, mission,
+                {'shutdown_on_completion': False}],
+            extra_arguments=intra_process
+        ))
+
+    container = ComposableNodeContainer(
+        name='crazyswarm_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container_mt',
+        composable_node_descriptions=nodes,
+        output='screen'
+    )
+
+    return [container]
+
+
+def generate_launch_description():
+    return LaunchDescription([
+        DeclareLaunchArgument('sim', default_value='false'),
+        DeclareLaunchArgument('mission', default_value=''),
+        OpaqueFunction(function=launch_setup)
+    ])
@@ -0,0 +1,69 @@
+import os
+import yaml
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, EmitEvent, OpaqueFunction, RegisterEventHandler
+from launch.event_handlers import OnProcessExit
+from launch.events import Shutdown
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import Node
+
+
+# the application as it flies, without crazyflies, and the jitter driver
+# streaming its poses and tag bursts, the driver prints the planning jitter
+# of the quiet and the burst phase and ends the launch
+def launch_setup(context, *args, **kwargs):
+    # load crazyflies
+    crazyflies_yaml = os.path.join(
+        get_package_share_directory('crazyflie'),
+        'config',
+        'crazyflies.yaml')
+
+    with open(crazyflies_yaml, 'r') as ymlfile:
+        crazyflies = yaml.safe_load(ymlfile)
+
+    # load swarm_manager parameters + load april tags configuration
+    config_yaml = os.path.join(
+        get_package_share_directory('crazyswarm_application'),
+        'launch',
+        'config.yaml')
+
+    with open(config_yaml, 'r') as ymlfile:
+        config = yaml.safe_load(ymlfile)
+
+    jitter = {
+        'jitter.burst_agents': int(LaunchConfiguration('burst_agents').perform(context)),
+        'jitter.phase_duration': float(LaunchConfiguration('phase_duration').perform(context)),
+    }
+
+    application = Node(
+        package='crazyswarm_application',
+        executable='crazyswarm_application_node',
+        name='crazyswarm_application_node',
+        output='screen',
+        parameters=[crazyflies, config]
+    )
+
+    driver = Node(
+        package='crazyswarm_application',
+        executable='jitter_driver',
+        name='jitter_driver',
+        output='screen',
+        parameters=[crazyflies, config, jitter]
+    )
+
+    return [
+        application,
+        driver,
+        RegisterEventHandler(OnProcessExit(
+            target_action=driver,
+            on_exit=[EmitEvent(event=Shutdown())]))
+    ]
+
+
+def generate_launch_description():
+    return LaunchDescription([
+        DeclareLaunchArgument('burst_agents', default_value='4'),
+        DeclareLaunchArgument('phase_duration', default_value='20.0'),
+        OpaqueFunction(function=launch_setup)
+    ])
@@ -35,6 +35,7 @@
 #include "rosgraph_msgs/msg/clock.hpp"
 
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
 
 #include "common.h"
 
@@ -161,8 +162,8 @@ class AprilDectectionProxy : public rclcpp::Node
 
     public:
 
-        AprilDectectionProxy()
-        : Node("april_dectection_proxy"), clock(RCL_ROS_TIME)
+        explicit AprilDectectionProxy(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("april_dectection_proxy", options), clock(RCL_ROS_TIME)
         {
             this->declare_parameter("april_tag_parameters.camera_rotation");
             this->declare_parameter("sim.hfov", -1.0);
@@ -190,7 +191,7 @@ class AprilDectectionProxy : public rclcpp::Node
             {
                 agent_camera_frame.insert({name, camera_frame()});
 
-                std::function<void(const PoseStamped::SharedPtr)> pcallback = 
+                std::function<void(const PoseStamped &)> pcallback = 
                     std::bind(&AprilDectectionProxy::pose_callback,
                     this, std::placeholders::_1, --agent_camera_frame.end());
                 pose_sub.insert({name, this->create_subscription<PoseStamped>(
@@ -283,25 +284,24 @@ class AprilDectectionProxy : public rclcpp::Node
             nwu_to_rdf.rotate(Eigen::AngleAxisd(-M_PI_2, Eigen::Vector3d(1,0,0)));
         }
 
-        void clock_callback(const Clock::SharedPtr msg)
+        void clock_callback(const Clock &msg)
         {
             // get sim_clock value
             sim_time = 
-                rclcpp::Time(msg->clock.sec, msg->clock.nanosec);
+                rclcpp::Time(msg.clock.sec, msg.clock.nanosec);
         }
 
-        void pose_callback(const PoseStamped::SharedPtr msg, 
+        void pose_callback(const PoseStamped &msg, 
             std::map<std::string, camera_frame>::iterator it)
         {
             Eigen::Affine3d transform;
-            PoseStamped copy = *msg;
             transform.translation() = 
-                Eigen::Vector3d(copy.pose.position.x, 
-                copy.pose.position.y, 
-                copy.pose.position.z);
+                Eigen::Vector3d(msg.pose.position.x, 
+                msg.pose.position.y, 
+                msg.pose.position.z);
             Eigen::Quaterniond q = Eigen::Quaterniond(
-                copy.pose.orientation.w, copy.pose.orientation.x,
-                copy.pose.orientation.y, copy.pose.orientation.z);
+                msg.pose.orientation.w, msg.pose.orientation.x,
+                msg.pose.orientation.y, msg.pose.orientation.z);
             
             transform.linear() = q.toRotationMatrix();
 
@@ -461,17 +461,12 @@ class AprilDectectionProxy : public rclcpp::Node
 
                 auto it = tag_pub.find(name);
                 if (it != tag_pub.end() && !tag_detection.detections.empty())
-                    it->second->publish(tag_detection);                
+                    it->second->publish(
+                        std::make_unique<AprilTagDetectionArray>(std::move(tag_detection)));
             }
 
             camera_fov_publisher->publish(camera_fov);
         }
 };
 
-int main(int argc, char * argv[])
-{
-    rclcpp::init(argc, argv);
-    rclcpp::spin(std::make_shared<AprilDectectionProxy>());
-    rclcpp::shutdown();
-    return 0;
-}
\ No newline at end of file
+RCLCPP_COMPONENTS_REGISTER_NODE(AprilDectectionProxy)
@@ -0,0 +1,125 @@
+/*
+* command_scheduler.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "command_scheduler.h"
+
+#include <algorithm>
+
+common::command_scheduler::command_scheduler(const scheduler_parameters &parameters) :
+    param(parameters)
+{
+}
+
+size_t common::command_scheduler::add_agent(size_t radio)
+{
+    size_t index = radios.size();
+    radios.push_back(radio);
+    last.emplace_back();
+
+    if (tokens.size() <= radio)
+        tokens.resize(radio + 1, param.radio_burst);
+
+    return index;
+}
+
+void common::command_scheduler::refill(double now)
+{
+    if (refilled)
+    {
+        double elapsed = std::max(now - last_refill, 0.0);
+        for (double &t : tokens)
+            t = std::min(param.radio_burst, t + elapsed * param.radio_rate);
+    }
+    last_refill = now;
+    refilled = true;
+}
+
+void common::command_scheduler::schedule(std::vector<velocity_command> &commands, 
+    const std::vector<double> &urgency, double now)
+{
+    double keep_alive = std::max(param.keep_alive, 1e-3);
+    // the longest an agent goes without a command, whatever the budget
+    double silence = param.keep_alive > 0.0 ? 
+        std::min(param.keep_alive, max_silence) : max_silence;
+
+    due.clear();
+    keep.assign(commands.size(), 0);
+    for (size_t k = 0; k < commands.size(); k++)
+    {
+        const velocity_command &command = commands[k];
+        const last_command &l = last[command.index];
+
+        // an agent that was never sent a command goes before the others
+        double waited = l.sent ? (now - l.time) / keep_alive : 1e6;
+
+        bool changed = !l.sent ||
+            (command.velocity - l.velocity).norm() > param.velocity_deadband ||
+            std::abs(command.height - l.height) > param.height_deadband;
+
+        if (!changed && now - l.time < std::min(param.keep_alive, silence))
+        {
+            suppressed_count++;
+            continue;
+        }
+
+        due.emplace_back(urgency[k] + waited, k);
+    }
+
+    if (param.radio_rate > 0.0)
+    {
+        refill(now);
+        std::sort(due.begin(), due.end(), 
+            [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b)
+            { return a.first > b.first; });
+    }
+
+    for (const auto &[priority, k] : due)
+    {
+        if (param.radio_rate > 0.0)
+        {
+            const last_command &l = last[commands[k].index];
+            bool overdue = !l.sent || now - l.time >= silence;
+
+            double &t = tokens[radios[commands[k].index]];
+            if (t < 1.0 && !overdue)
+            {
+                deferred_count++;
+                continue;
+            }
+            // an overdue command takes the bucket below empty
+            t -= 1.0;
+        }
+        keep[k] = 1;
+    }
+
+    size_t kept = 0;
+    for (size_t k = 0; k < commands.size(); k++)
+    {
+        if (!keep[k])
+            continue;
+
+        last_command &l = last[commands[k].index];
+        l.sent = true;
+        l.velocity = commands[k].velocity;
+        l.height = commands[k].height;
+        l.time = now;
+
+        commands[kept++] = commands[k];
+    }
+    commands.resize(kept);
+}
@@ -35,6 +35,126 @@ std::set<std::string> common::extract_names(
     return result;
 }
 
+std::map<std::string, common::obstacle> common::load_obstacles(
+    const std::map<std::string, rclcpp::ParameterValue> &parameter_overrides)
+{
+    std::map<std::string, obstacle> result;
+    const std::string prefix = "environment.obstacles.";
+
+    for (const auto &name : extract_names(parameter_overrides, "environment.obstacles"))
+    {
+        obstacle obs;
+        obs.type = parameter_overrides.at(prefix + name + ".type").get<std::string>();
+
+        std::vector<double> height = 
+            parameter_overrides.at(prefix + name + ".height").get<std::vector<double>>();
+        assert(height.size() == 2);
+        obs.height = std::make_pair(height[0], height[1]);
+
+        // points are given as a flat list of x, y pairs
+        std::vector<double> points = 
+            parameter_overrides.at(prefix + name + ".points").get<std::vector<double>>();
+        assert(points.size() % 2 == 0);
+        for (size_t i = 0; i + 1 < points.size(); i += 2)
+            obs.points.emplace_back(points[i], points[i+1]);
+
+        result.insert({name, obs});
+    }
+
+    return result;
+}
+
+size_t common::swarm_registry::add(
+    const std::string &name, const Eigen::Vector3d &initial_position,
+    bool is_mission_capable, const rclcpp::Time &now)
+{
+    size_t index = names.size();
+
+    std::string str_copy = name;
+    // Remove cf from cfXX
+    str_copy.erase(0,2);
+
+    names.push_back(name);
+    ids.push_back(std::stoi(str_copy));
+    t.push_back(now);
+    sequence.push_back(0);
+    received.push_back(0);
+    position.push_back(initial_position);
+    orientation.push_back(Eigen::Quaterniond::Identity());
+    velocity.push_back(Eigen::Vector3d::Zero());
+    target_queue.emplace_back();
+    target_yaw.push_back(0.0);
+    previous_target.push_back(initial_position);
+    flight_state.push_back(IDLE);
+    radio_connection.push_back(false);
+    completed.push_back(false);
+    mission_capable.push_back(is_mission_capable);
+
+    lookup.insert({name, index});
+
+    pose_sample initial = {};
+    initial.position[0] = initial_position.x();
+    initial.position[1] = initial_position.y();
+    initial.position[2] = initial_position.z();
+    initial.orientation[0] = 1.0;
+    pose_buffer.emplace_back();
+    pose_buffer.back().store(initial);
+    twist_buffer.emplace_back();
+
+    return index;
+}
+
+bool common::swarm_registry::find(
+    const std::string &name, size_t &index) const
+{
+    auto it = lookup.find(name);
+    if (it == lookup.end())
+        return false;
+    index = it->second;
+    return true;
+}
+
+Eigen::Affine3d common::swarm_registry::transform(size_t index) const
+{
+    Eigen::Affine3d aff = Eigen::Affine3d::Identity();
+    aff.translation() = position[index];
+    aff.linear() = orientation[index].toRotationMatrix();
+    return aff;
+}
+
+Eigen::Affine3d common::swarm_registry::latest_transform(size_t index) const
+{
+    pose_sample p = pose_buffer[index].load();
+    Eigen::Affine3d aff = Eigen::Affine3d::Identity();
+    aff.translation() = 
+        Eigen::Vector3d(p.position[0], p.position[1], p.position[2]);
+    aff.linear() = Eigen::Quaterniond(p.orientation[0], p.orientation[1],
+        p.orientation[2], p.orientation[3]).toRotationMatrix();
+    return aff;
+}
+
+void common::swarm_registry::snapshot()
+{
+    for (size_t i = 0; i < size(); i++)
+    {
+        // the first store is the initial position from the parameters
+        if (pose_buffer[i].version() > 1)
+        {
+            pose_sample p = pose_buffer[i].load();
+            t[i] = rclcpp::Time(p.stamp, RCL_ROS_TIME);
+            sequence[i] = p.sequence;
+            received[i] = p.received;
+            position[i] = Eigen::Vector3d(p.position[0], p.position[1], p.position[2]);
+            orientation[i] = Eigen::Quaterniond(p.orientation[0], p.orientation[1],
+                p.orientation[2], p.orientation[3]);
+            radio_connection[i] = true;
+        }
+
+        twist_sample v = twist_buffer[i].load();
+        velocity[i] = Eigen::Vector3d(v.linear[0], v.linear[1], v.linear[2]);
+    }
+}
+
 Eigen::Vector4f common::quat_to_vec4(Eigen::Quaterniond q)
 {
     Eigen::Vector4f v;
@@ -18,58 +18,71 @@
 
 #include "crazyswarm_app.h"
 
-int main(int argc, char *argv[])
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+
+void cs2::cs2_application::start_planning_thread()
 {
-    rclcpp::init(argc, argv);
-
-    size_t thread_count = 5;
-    rclcpp::executors::MultiThreadedExecutor 
-        executor(rclcpp::ExecutorOptions(), thread_count, false);
-    auto node = std::make_shared<cs2::cs2_application>();
-    executor.add_node(node);
-    executor.spin();
-    rclcpp::shutdown();
-    
-    return 0;
+    // the planning tick gets a thread of its own, also when the node is
+    // loaded into a component container
+    planning_executor.add_callback_group(
+        planning_group, this->get_node_base_interface());
+    planning_thread = std::thread([this]()
+    {
+        if (planning_priority > 0)
+        {
+            sched_param param;
+            param.sched_priority = planning_priority;
+            int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (error != 0)
+                RCLCPP_WARN(this->get_logger(), 
+                    "planning thread priority %d not set (%s)", planning_priority, strerror(error));
+        }
+        planning_executor.spin();
+    });
 }
 
-void cs2::cs2_application::user_callback(
-    const UserCommand::SharedPtr msg)
+void cs2::cs2_application::user_callback(const UserCommand &msg)
 {
     RCLCPP_INFO(this->get_logger(), "received command");
+    // the wait for the planning tick is part of the dispatch
+    scoped_latency timed(stage_latency[MISSION_DISPATCH]);
+    std::lock_guard<std::mutex> lock(planning_mutex);
     using namespace cs2;
-    UserCommand copy = *msg;
     string_dictionary dict;
 
     // handle goto_velocity
-    if (strcmp(copy.cmd.c_str(), 
+    if (strcmp(msg.cmd.c_str(), 
         dict.go_to_velocity.c_str()) == 0)
     {
-        for (size_t i = 0; i < copy.uav_id.size(); i++)
+        for (size_t i = 0; i < msg.uav_id.size(); i++)
         {           
-            auto iterator_states = agents_states.find(copy.uav_id[i]);
-            if (iterator_states == agents_states.end())
+            size_t index;
+            if (!swarm.find(msg.uav_id[i], index))
                 continue;
 
             // check if the command is external, if so, keep changing the goal
-            if (copy.is_external)
-                 while (!iterator_states->second.target_queue.empty())
-                    iterator_states->second.target_queue.pop();
+            if (msg.is_external)
+                 while (!swarm.target_queue[index].empty())
+                    swarm.target_queue[index].pop();
 
-            iterator_states->second.target_queue.push(
-                Eigen::Vector3d(copy.goal.x, copy.goal.y, copy.goal.z)
+            swarm.target_queue[index].push(
+                Eigen::Vector3d(msg.goal.x, msg.goal.y, msg.goal.z)
             );
 
-            iterator_states->second.flight_state = MOVE_VELOCITY;
-            iterator_states->second.completed = false;
+            swarm.flight_state[index] = MOVE_VELOCITY;
+            swarm.completed[index] = false;
         }
     }
     // handle takeoff_all and land_all
-    else if (strcmp(copy.cmd.c_str(), dict.takeoff_all.c_str()) == 0 || 
-        strcmp(copy.cmd.c_str(), dict.land_all.c_str()) == 0)
+    else if (strcmp(msg.cmd.c_str(), dict.takeoff_all.c_str()) == 0 || 
+        strcmp(msg.cmd.c_str(), dict.land_all.c_str()) == 0)
     {
         bool is_takeoff_all = 
-            strcmp(copy.cmd.c_str(), dict.takeoff_all.c_str()) == 0;
+            strcmp(msg.cmd.c_str(), dict.takeoff_all.c_str()) == 0;
 
         RCLCPP_INFO(this->get_logger(), "%s", is_takeoff_all ? "takeoff request all" : "land request all");
 
@@ -93,18 +106,18 @@ void cs2::cs2_application::user_callback(
             // auto response = result.get();
 
             // Iterate through the agents
-            for (auto &[key, agent] : agents_states)
+            for (size_t i = 0; i < swarm.size(); i++)
             {
-                Eigen::Vector3d trans = agent.transform.translation();
+                Eigen::Vector3d trans = swarm.position[i];
                 
-                while (!agent.target_queue.empty())
-                    agent.target_queue.pop();
+                while (!swarm.target_queue[i].empty())
+                    swarm.target_queue[i].pop();
 
-                agent.target_queue.push(
+                swarm.target_queue[i].push(
                     Eigen::Vector3d(trans.x(), trans.y(), takeoff_height)
                 );
-                agent.flight_state = is_takeoff_all ? TAKEOFF : LAND;
-                agent.completed = false;
+                swarm.flight_state[i] = is_takeoff_all ? TAKEOFF : LAND;
+                swarm.completed[i] = false;
             }
         }
         else
@@ -126,18 +139,18 @@ void cs2::cs2_application::user_callback(
             // auto response = result.get();
 
             // Iterate through the agents
-            for (auto &[key, agent] : agents_states)
+            for (size_t i = 0; i < swarm.size(); i++)
             {
-                Eigen::Vector3d trans = agent.transform.translation();
+                Eigen::Vector3d trans = swarm.position[i];
                 
-                while (!agent.target_queue.empty())
-                    agent.target_queue.pop();
+                while (!swarm.target_queue[i].empty())
+                    swarm.target_queue[i].pop();
 
-                agent.target_queue.push(
+                swarm.target_queue[i].push(
                     Eigen::Vector3d(trans.x(), trans.y(), 0.0)
                 );
-                agent.flight_state = is_takeoff_all ? TAKEOFF : LAND;
-                agent.completed = false;
+                swarm.flight_state[i] = is_takeoff_all ? TAKEOFF : LAND;
+                swarm.completed[i] = false;
             }
         }
 
@@ -145,78 +158,168 @@ void cs2::cs2_application::user_callback(
             is_takeoff_all ? "takeoff_all_sent" : "land_all_sent", (clock.now() - start).seconds()*1000.0);
     }
     // handle land and go_to
-    else if (strcmp(copy.cmd.c_str(), dict.land.c_str()) == 0 || 
-        strcmp(copy.cmd.c_str(), dict.go_to.c_str()) == 0)
+    else if (strcmp(msg.cmd.c_str(), dict.land.c_str()) == 0 || 
+        strcmp(msg.cmd.c_str(), dict.go_to.c_str()) == 0)
     {
-        bool is_go_to = strcmp(copy.cmd.c_str(), dict.go_to.c_str()) == 0;
+        bool is_go_to = strcmp(msg.cmd.c_str(), dict.go_to.c_str()) == 0;
+        auto start = clock.now();
 
-        std::queue<int> check_queue;
-        for (size_t i = 0; i < copy.uav_id.size(); i++)
+        std::vector<size_t> members;
+        std::vector<std::string> not_found;
+        for (size_t i = 0; i < msg.uav_id.size(); i++)
         {
-            // get position and distance
-            auto iterator = agents_comm.find(copy.uav_id[i]);
-            if (iterator == agents_comm.end())
-                continue;
-            
-            auto iterator_states = agents_states.find(copy.uav_id[i]);
-            if (iterator_states == agents_states.end())
-                continue;
-            
-            if (!is_go_to)
+            size_t index;
+            if (!swarm.find(msg.uav_id[i], index))
             {
-                auto start = clock.now();
+                not_found.push_back(msg.uav_id[i]);
+                continue;
+            }
+            members.push_back(index);
+        }
 
-                send_land_and_update(iterator_states, iterator);
+        // each agent flies for as long as it would alone
+        std::vector<double> durations;
+        Eigen::Vector3d goal(msg.goal.x, msg.goal.y, msg.goal.z);
+        for (size_t index : members)
+        {
+            durations.push_back(is_go_to ?
+                (swarm.position[index] - goal).norm() / max_velocity :
+                swarm.position[index].z() / takeoff_land_velocity);
 
-                RCLCPP_INFO(this->get_logger(), "land sent for %s and changing group_mask (%lfms)", 
-                    iterator->first.c_str(), (clock.now() - start).seconds()*1000.0);
-                
-                check_queue.push(i);
-            }
-            else
-            {
-                auto start = clock.now();
+            while (!swarm.target_queue[index].empty())
+                swarm.target_queue[index].pop();
 
-                auto request = std::make_shared<GoTo::Request>();
-                double distance = 
-                    (iterator_states->second.transform.translation() - 
-                    Eigen::Vector3d(copy.goal.x, copy.goal.y, copy.goal.z)).norm();
-                request->group_mask = 0;
-                request->relative = false;
-                request->goal = copy.goal;
-                request->yaw = copy.yaw;
+            if (!is_go_to)
+                swarm.target_queue[index].push(
+                    Eigen::Vector3d(swarm.position[index].x(), swarm.position[index].y(), 0.0));
 
-                double sec = std::floor(distance / max_velocity);
-                double nanosec = (distance / max_velocity - std::floor(distance / max_velocity)) * 1e9;
+            swarm.flight_state[index] = is_go_to ? MOVE : LAND;
+            swarm.completed[index] = false;
+        }
 
-                request->duration.sec = sec;
-                request->duration.nanosec = nanosec;
+        auto to_duration = [](double seconds)
+        {
+            builtin_interfaces::msg::Duration d;
+            d.sec = std::floor(seconds);
+            d.nanosec = (seconds - std::floor(seconds)) * 1e9;
+            return d;
+        };
+
+        // one request per agent with its own duration, for the agents out
+        // of the broadcast or when its group masks did not go through
+        geometry_msgs::msg::Point goal_point = msg.goal;
+        auto yaw = msg.yaw;
+        auto send_each = [this, is_go_to, goal_point, yaw, to_duration](
+            const std::vector<size_t> &agents, const std::vector<double> &seconds)
+        {
+            return [this, is_go_to, goal_point, yaw, to_duration, agents, seconds]()
+            {
+                for (size_t i = 0; i < agents.size(); i++)
+                {
+                    size_t index = agents[i];
+                    if (is_go_to)
+                    {
+                        auto request = std::make_shared<GoTo::Request>();
+                        request->group_mask = 0;
+                        request->relative = false;
+                        request->goal = goal_point;
+                        request->yaw = yaw;
+                        request->duration = to_duration(seconds[i]);
+                        agents_comm[index].go_to->async_send_request(request);
+                    }
+                    else
+                    {
+                        auto request = std::make_shared<Land::Request>();
+                        request->group_mask = 0;
+                        request->height = 0.0;
+                        request->duration = to_duration(seconds[i]);
+                        agents_comm[index].land->async_send_request(request);
+                    }
+                }
+            };
+        };
+
+        // the broadcast has one duration, it goes to the most agents whose
+        // durations are within group_duration_tolerance of each other
+        std::vector<size_t> order(members.size());
+        for (size_t k = 0; k < order.size(); k++)
+            order[k] = k;
+        std::sort(order.begin(), order.end(), 
+            [&durations](size_t a, size_t b) { return durations[a] < durations[b]; });
+
+        size_t first = 0, count = 0;
+        for (size_t i = 0, j = 0; j < order.size(); j++)
+        {
+            while (durations[order[j]] - durations[order[i]] > group_duration_tolerance)
+                i++;
+            if (j - i + 1 > count)
+            {
+                first = i;
+                count = j - i + 1;
+            }
+        }
 
-                auto result = 
-                    iterator->second.go_to->async_send_request(request);
-                check_queue.push(i);
+        std::vector<size_t> group, others;
+        std::vector<double> group_durations, other_durations;
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            bool in_group = k >= first && k < first + count;
+            (in_group ? group : others).push_back(members[order[k]]);
+            (in_group ? group_durations : other_durations).push_back(durations[order[k]]);
+        }
 
-                while (!iterator_states->second.target_queue.empty())
-                    iterator_states->second.target_queue.pop();
+        // every agent has to take its group mask before the broadcast
+        bool broadcast = group_broadcast && group.size() > 1 && 
+            (is_go_to ? go_to_all_client->service_is_ready() : 
+            land_all_client->service_is_ready());
+        for (size_t index : group)
+            broadcast = broadcast && agents_comm[index].set_group->service_is_ready();
 
-                iterator_states->second.flight_state = MOVE;
-                iterator_states->second.completed = false;
+        if (broadcast)
+        {
+            // the slowest of the group, none goes faster than it would alone
+            builtin_interfaces::msg::Duration request_duration = 
+                to_duration(group_durations.back());
 
-                RCLCPP_INFO(this->get_logger(), "go_to sent for %s (%lfms)", 
-                    iterator->first.c_str(), (clock.now() - start).seconds()*1000.0);
+            if (is_go_to)
+            {
+                auto client = go_to_all_client;
+                broadcast_to_group(group, [client, goal_point, yaw, request_duration](uint8_t mask)
+                {
+                    auto request = std::make_shared<GoTo::Request>();
+                    request->group_mask = mask;
+                    request->relative = false;
+                    request->goal = goal_point;
+                    request->yaw = yaw;
+                    request->duration = request_duration;
+                    client->async_send_request(request);
+                }, send_each(group, group_durations));
+            }
+            else
+            {
+                auto client = land_all_client;
+                broadcast_to_group(group, [client, request_duration](uint8_t mask)
+                {
+                    auto request = std::make_shared<Land::Request>();
+                    request->group_mask = mask;
+                    request->height = 0.0;
+                    request->duration = request_duration;
+                    client->async_send_request(request);
+                }, send_each(group, group_durations));
             }
+            send_each(others, other_durations)();
         }
+        else
+            send_each(members, durations)();
+
+        RCLCPP_INFO(this->get_logger(), "%s sent for %zu agents, %zu as one broadcast (%lfms)", 
+            is_go_to ? "go_to" : "land", members.size(), 
+            broadcast ? group.size() : 0, (clock.now() - start).seconds()*1000.0);
 
-        if (check_queue.size() != copy.uav_id.size())
+        if (!not_found.empty())
         {
-            while (!check_queue.empty())
-            {
-                copy.uav_id.erase(copy.uav_id.begin() + (check_queue.front()-1));
-                check_queue.pop();
-            }
-            
             std::cout << "uav_id not found ";
-            for (const auto& i: copy.uav_id)
+            for (const auto& i: not_found)
                 std::cout << i << " ";
             std::cout << std::endl;
 
@@ -234,91 +337,248 @@ void cs2::cs2_application::user_callback(
 }
 
 void cs2::cs2_application::pose_callback(
-    const PoseStamped::SharedPtr msg, 
-    std::map<std::string, agent_state>::iterator state)
+    const PoseStamped &msg, size_t index)
 {
-    agent_update_mutex.lock();
+    scoped_latency timed(stage_latency[POSE_INGESTION]);
+
+    // RCLCPP_INFO(this->get_logger(), "(%s) %lf %lf %lf", swarm.names[index].c_str(), 
+    //     msg.pose.position.x, msg.pose.position.y, msg.pose.position.z);
+    pose_sample sample;
+    sample.stamp = rclcpp::Time(msg.header.stamp).nanoseconds();
+    sample.position[0] = msg.pose.position.x;
+    sample.position[1] = msg.pose.position.y;
+    sample.position[2] = msg.pose.position.z;
+    sample.orientation[0] = msg.pose.orientation.w;
+    sample.orientation[1] = msg.pose.orientation.x;
+    sample.orientation[2] = msg.pose.orientation.y;
+    sample.orientation[3] = msg.pose.orientation.z;
+
+    ingest_pose(index, sample);
+}
 
-    PoseStamped copy = *msg;
-    auto pos = state->second.transform.translation();
-    // RCLCPP_INFO(this->get_logger(), "(%s) %lf %lf %lf", state->first.c_str(), 
-    //     pos[0], pos[1], pos[2]);
-    state->second.transform.translation() = 
-        Eigen::Vector3d(copy.pose.position.x, copy.pose.position.y, copy.pose.position.z);
-    Eigen::Quaterniond q = Eigen::Quaterniond(
-        copy.pose.orientation.w, copy.pose.orientation.x,
-        copy.pose.orientation.y, copy.pose.orientation.z);
-    state->second.transform.linear() = q.toRotationMatrix();
-    state->second.t = copy.header.stamp;
-
-    // check agents_tag_queue and update s_queue
-    std::map<std::string, tag_queue>::iterator it = 
-        agents_tag_queue.find(state->first);
-    
-    if (it != agents_tag_queue.end())
+void cs2::cs2_application::named_poses_callback(const NamedPoseArray &msg)
+{
+    scoped_latency timed(stage_latency[POSE_INGESTION]);
+
+    int64_t stamp = rclcpp::Time(msg.header.stamp).nanoseconds();
+
+    if (pose_slots.size() < msg.poses.size())
+        pose_slots.resize(msg.poses.size(), {"", std::string::npos});
+
+    for (size_t i = 0; i < msg.poses.size(); i++)
     {
-        if (it->second.s_queue.size() > max_queue_size)
-            it->second.s_queue.pop();
-        it->second.s_queue.push(state->second);
+        const NamedPose &named = msg.poses[i];
+
+        // the body at this position changed, look its name up once
+        pose_slot &slot = pose_slots[i];
+        if (slot.name != named.name)
+        {
+            slot.name = named.name;
+            if (!swarm.find(named.name, slot.index))
+                slot.index = std::string::npos;
+        }
+
+        if (slot.index == std::string::npos)
+            continue;
+
+        pose_sample sample;
+        sample.stamp = stamp;
+        sample.position[0] = named.pose.position.x;
+        sample.position[1] = named.pose.position.y;
+        sample.position[2] = named.pose.position.z;
+        sample.orientation[0] = named.pose.orientation.w;
+        sample.orientation[1] = named.pose.orientation.x;
+        sample.orientation[2] = named.pose.orientation.y;
+        sample.orientation[3] = named.pose.orientation.z;
+
+        if (estimate_velocity)
+            estimate_twist(slot.index, sample);
+
+        ingest_pose(slot.index, sample);
     }
+}
+
+void cs2::cs2_application::ingest_pose(
+    size_t index, pose_sample sample)
+{
+    // the commands planned from this sample carry these back
+    sample.sequence = agents_pose_sequence[index].fetch_add(
+        1, std::memory_order_relaxed) + 1;
+    sample.received = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    CS2_TRACEPOINT(pose_ingested, (uint32_t)index, sample.sequence, sample.stamp);
+
+    // the planner reads this in its snapshot, no lock is needed
+    swarm.pose_buffer[index].store(sample);
 
-    state->second.radio_connection = true;
+    if (event_driven_planning)
+        notify_pose_event(index);
 
-    agent_update_mutex.unlock();
+    // pose history used by the tag handler, read without a lock
+    agents_pose_history[index].push(sample);
 }
 
-void cs2::cs2_application::twist_callback(
-    const Twist::SharedPtr msg, 
-    std::map<std::string, agent_state>::iterator state)
+void cs2::cs2_application::estimate_twist(
+    size_t index, const pose_sample &sample)
 {
-    agent_update_mutex.lock();
+    // the first store is the initial position from the parameters
+    if (swarm.pose_buffer[index].version() < 2)
+        return;
+
+    pose_sample previous = swarm.pose_buffer[index].load();
+    if (sample.stamp <= previous.stamp)
+        return;
+
+    double dt = (double)(sample.stamp - previous.stamp) * 1e-9;
+
+    // finite difference, smoothed against the mocap noise
+    twist_sample last = swarm.twist_buffer[index].load();
+    twist_sample twist;
+    for (size_t i = 0; i < 3; i++)
+    {
+        double v = (sample.position[i] - previous.position[i]) / dt;
+        twist.linear[i] = velocity_smoothing * last.linear[i] + 
+            (1.0 - velocity_smoothing) * v;
+    }
+    swarm.twist_buffer[index].store(twist);
+}
 
-    Twist copy = *msg;
+void cs2::cs2_application::twist_callback(
+    const Twist &msg, size_t index)
+{
     // Eigen::Vector3d pos = pose.second.translation();
     // RCLCPP_INFO(this->get_logger(), "(%ld) %lf %lf %lf", pose.first, 
     //     pos[0], pos[1], pos[2]);
-    state->second.velocity = 
-        Eigen::Vector3d(copy.linear.x, copy.linear.y, copy.linear.z);
-    
-    agent_update_mutex.unlock();
+    twist_sample sample;
+    sample.linear[0] = msg.linear.x;
+    sample.linear[1] = msg.linear.y;
+    sample.linear[2] = msg.linear.z;
+    swarm.twist_buffer[index].store(sample);
 }
 
-void cs2::cs2_application::send_land_and_update(
-    std::map<std::string, agent_state>::iterator s,
-    std::map<std::string, agent_struct>::iterator c)
+void cs2::cs2_application::send_land_and_update(size_t index)
 {
     auto request_land = std::make_shared<Land::Request>();
     request_land->group_mask = 0;
     request_land->height = 0.0;
 
-    agent_update_mutex.lock();
-
-    double sec = std::floor(s->second.transform.translation().z() / takeoff_land_velocity);
-    double nanosec = (s->second.transform.translation().z() / takeoff_land_velocity - 
-        std::floor(s->second.transform.translation().z() / takeoff_land_velocity)) * 1e9;
+    double sec = std::floor(swarm.position[index].z() / takeoff_land_velocity);
+    double nanosec = (swarm.position[index].z() / takeoff_land_velocity - 
+        std::floor(swarm.position[index].z() / takeoff_land_velocity)) * 1e9;
 
     request_land->duration.sec = sec;
     request_land->duration.nanosec = nanosec;
 
     auto result_land = 
-        c->second.land->async_send_request(request_land);
-    
-    auto request_group = std::make_shared<SetGroupMask::Request>();
-    request_group->group_mask = 1;
-    auto result_group = 
-        c->second.set_group->async_send_request(request_group);
+        agents_comm[index].land->async_send_request(request_land);
     
-    Eigen::Vector3d trans = s->second.transform.translation();
+    Eigen::Vector3d trans = swarm.position[index];
 
-    while (!s->second.target_queue.empty())
-        s->second.target_queue.pop();
+    while (!swarm.target_queue[index].empty())
+        swarm.target_queue[index].pop();
 
-    s->second.target_queue.push(
+    swarm.target_queue[index].push(
         Eigen::Vector3d(trans.x(), trans.y(), 0.0)
     );
 
-    agent_update_mutex.unlock();
+    swarm.flight_state[index] = LAND;
+    swarm.completed[index] = false;
+}
+
+void cs2::cs2_application::broadcast_to_group(
+    const std::vector<size_t> &members, std::function<void(uint8_t)> send,
+    std::function<void()> fallback)
+{
+    // called under planning_mutex, which guards command_groups
+    std::vector<std::pair<size_t, uint8_t>> changes;
+    size_t group = command_groups->select(members, changes);
+
+    // agents out of the command may need a new mask as well
+    for (const auto &change : changes)
+    {
+        if (!agents_comm[change.first].set_group->service_is_ready())
+        {
+            fallback();
+            return;
+        }
+    }
+    command_groups->use(group);
+    uint8_t mask = group_masks::group_mask(group);
+
+    if (changes.empty())
+    {
+        send(mask);
+        return;
+    }
+
+    // the broadcast waits for every new mask, an agent leaving the group
+    // would follow it otherwise
+    auto broadcast = std::make_shared<pending_broadcast>();
+    broadcast->pending = changes.size();
+    broadcast->acknowledged.assign(changes.size(), 0);
+
+    {
+        std::lock_guard<std::mutex> lock(broadcast->mutex);
+        broadcast->timeout = this->create_wall_timer(
+            std::chrono::duration<double>(group_mask_timeout),
+            [this, broadcast, changes, fallback, group]()
+            {
+                std::vector<uint8_t> acknowledged;
+                {
+                    std::lock_guard<std::mutex> lock(broadcast->mutex);
+                    // fires once, the timer only lives in the broadcast
+                    broadcast->timeout->cancel();
+                    broadcast->timeout.reset();
+                    if (broadcast->done)
+                        return;
+                    broadcast->done = true;
+                    acknowledged = broadcast->acknowledged;
+                }
+
+                // a request may still land after this, the mask is not known
+                {
+                    std::lock_guard<std::mutex> lock(planning_mutex);
+                    for (size_t k = 0; k < changes.size(); k++)
+                        if (!acknowledged[k])
+                            command_groups->forget(changes[k].first);
+                }
+
+                RCLCPP_WARN(this->get_logger(), "group %zu masks not acknowledged "
+                    "within %.2lfs, sent to each agent", group, group_mask_timeout);
+                fallback();
+            }, user_group);
+    }
+
+    for (size_t k = 0; k < changes.size(); k++)
+    {
+        size_t agent = changes[k].first;
+        uint8_t agent_mask = changes[k].second;
+
+        auto request = std::make_shared<SetGroupMask::Request>();
+        request->group_mask = agent_mask;
+        agents_comm[agent].set_group->async_send_request(request, 
+            [this, broadcast, send, mask, k, agent, agent_mask](
+                rclcpp::Client<SetGroupMask>::SharedFuture)
+            {
+                // the crazyflie has the mask, even after the timeout
+                {
+                    std::lock_guard<std::mutex> lock(planning_mutex);
+                    command_groups->set(agent, agent_mask);
+                }
+
+                std::lock_guard<std::mutex> lock(broadcast->mutex);
+                broadcast->acknowledged[k] = 1;
+                if (--broadcast->pending > 0 || broadcast->done)
+                    return;
+                broadcast->done = true;
+                broadcast->timeout->cancel();
+                broadcast->timeout.reset();
+                send(mask);
+            });
+    }
+
+    RCLCPP_INFO(this->get_logger(), "group %zu, %zu group masks changed", 
+        group, changes.size());
+}
 
-    s->second.flight_state = LAND;
-    s->second.completed = false;
-}
\ No newline at end of file
+RCLCPP_COMPONENTS_REGISTER_NODE(cs2::cs2_application)
@@ -0,0 +1,35 @@
+/*
+* crazyswarm_app_main.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "crazyswarm_app.h"
+
+int main(int argc, char *argv[])
+{
+    rclcpp::init(argc, argv);
+
+    // the node spins its planning tick on a thread of its own
+    size_t thread_count = 5;
+    rclcpp::executors::MultiThreadedExecutor 
+        executor(rclcpp::ExecutorOptions(), thread_count, false);
+    auto node = std::make_shared<cs2::cs2_application>();
+    executor.add_node(node);
+    executor.spin();
+    rclcpp::shutdown();
+    
+    return 0;
+}
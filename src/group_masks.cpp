@@ -0,0 +1,62 @@
+/*
+* group_masks.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "group_masks.h"
+
+size_t common::group_masks::select(const std::vector<size_t> &members,
+    std::vector<std::pair<size_t, uint8_t>> &changes) const
+{
+    std::vector<uint8_t> wanted(masks.size(), 0);
+    for (size_t agent : members)
+        wanted[agent] = 1;
+
+    size_t best = 0;
+    size_t best_cost = masks.size() + 1;
+    for (size_t g = 0; g < groups; g++)
+    {
+        uint8_t bit = group_mask(g);
+
+        // agents that have to join or leave the bit
+        size_t cost = 0;
+        for (size_t i = 0; i < masks.size(); i++)
+            if (!known[i] || ((masks[i] & bit) != 0) != (wanted[i] != 0))
+                cost++;
+
+        if (cost < best_cost || 
+            (cost == best_cost && last_used[g] < last_used[best]))
+        {
+            best = g;
+            best_cost = cost;
+        }
+    }
+
+    changes.clear();
+    uint8_t bit = group_mask(best);
+    for (size_t i = 0; i < masks.size(); i++)
+    {
+        // the other bits are not known either, they are cleared
+        if (!known[i])
+            changes.emplace_back(i, (uint8_t)(wanted[i] ? bit : 0));
+        else if (wanted[i] && (masks[i] & bit) == 0)
+            changes.emplace_back(i, (uint8_t)(masks[i] | bit));
+        else if (!wanted[i] && (masks[i] & bit) != 0)
+            changes.emplace_back(i, (uint8_t)(masks[i] & ~bit));
+    }
+
+    return best;
+}
@@ -18,29 +18,19 @@
 
 #include "crazyswarm_app.h"
 
-#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
-#include <gtsam/slam/BetweenFactor.h>
-
 void cs2::cs2_application::tag_callback(
-    const AprilTagDetectionArray::SharedPtr& msg, std::string name)
-{
-    AprilTagDetectionArray copy = *msg;
-
-    auto iterator = agents_tag_queue.find(name);
-    if (iterator == agents_tag_queue.end())
+    const AprilTagDetectionArray &detections, size_t index)
+{    
+    if (detections.detections.empty())
         return;
 
-    auto agent_it = agents_states.find(name);
-    if (agent_it == agents_states.end())
-        return;
-    
-    if (copy.detections.empty())
-        return;
+    scoped_latency timed(stage_latency[TAG_CALLBACK]);
 
     std::vector<tag> tag_vect;
+    tag_queue &queue = agents_tag_queue[index];
 
-    // Push the detection in to the queue
-    for (AprilTagDetection &d : copy.detections)
+    // Push the detection in to the ring
+    for (const AprilTagDetection &d : detections.detections)
     {
         if (Eigen::Vector3d(d.pose.pose.position.x,
             d.pose.pose.position.y, d.pose.pose.position.z).norm() > observation_threshold)
@@ -48,7 +38,7 @@ void cs2::cs2_application::tag_callback(
 
         tag tmp;
         tmp.id = d.id;
-        tmp.t = copy.header.stamp;
+        tmp.t = detections.header.stamp;
         tmp.transform.translation() = Eigen::Vector3d(
             d.pose.pose.position.x,
             d.pose.pose.position.y,
@@ -76,20 +66,32 @@ void cs2::cs2_application::tag_callback(
         tmp.pixel_center.x() = d.centre.x;
         tmp.pixel_center.y() = d.centre.y;
 
-        tag_queue_mutex.lock();
-        iterator->second.t_queue.push(tmp);
-        tag_queue_mutex.unlock();
+        Eigen::Quaterniond q_tb(tag_to_body.linear());
+        tag_sample sample;
+        sample.stamp = tmp.t.nanoseconds();
+        sample.id = tmp.id;
+        sample.pixel_center[0] = tmp.pixel_center.x();
+        sample.pixel_center[1] = tmp.pixel_center.y();
+        sample.position[0] = tag_to_body.translation().x();
+        sample.position[1] = tag_to_body.translation().y();
+        sample.position[2] = tag_to_body.translation().z();
+        sample.orientation[0] = q_tb.w();
+        sample.orientation[1] = q_tb.x();
+        sample.orientation[2] = q_tb.y();
+        sample.orientation[3] = q_tb.z();
+        // a full ring is counted in its drops
+        queue.push(sample);
 
         tag_vect.emplace_back(tmp);
     }
 
     // RCLCPP_INFO(this->get_logger(), 
-    //     "agent %s detected tag (size %ld)", name.c_str(), iterator->second.t_queue.size());
+    //     "agent %s detected tag (drops %lu)", swarm.names[index].c_str(), agents_tag_queue[index].dropped());
 
     for (auto &single : tag_vect)
     {
         TransformStamped msg2;
-        msg2.header.frame_id = name;
+        msg2.header.frame_id = swarm.names[index];
         msg2.header.stamp = clock.now();
         msg2.child_frame_id = "april" + std::to_string(single.id);
         
@@ -106,7 +108,7 @@ void cs2::cs2_application::tag_callback(
         tf2_bc.sendTransform(msg2);
 
         // Eigen::Affine3d tag_to_world = 
-        //     agent_it->second.transform * single.transform;
+        //     swarm.transform(index) * single.transform;
         // Eigen::Quaterniond q_tw(tag_to_world.linear());
 
         // msg2.header.frame_id = "/world";
@@ -122,150 +124,267 @@ void cs2::cs2_application::tag_callback(
     }
 }
 
+void cs2::cs2_application::drain_tags(size_t index, std::queue<tag> &tags)
+{
+    tag_queue &queue = agents_tag_queue[index];
+
+    queue.drain([&tags](const tag_sample &sample)
+    {
+        tag t;
+        t.t = rclcpp::Time(sample.stamp, RCL_ROS_TIME);
+        t.id = sample.id;
+        t.transform = Eigen::Affine3d::Identity();
+        t.transform.translation() = Eigen::Vector3d(
+            sample.position[0], sample.position[1], sample.position[2]);
+        t.transform.linear() = Eigen::Quaterniond(
+            sample.orientation[0], sample.orientation[1], 
+            sample.orientation[2], sample.orientation[3]).toRotationMatrix();
+        t.pixel_center.x() = sample.pixel_center[0];
+        t.pixel_center.y() = sample.pixel_center[1];
+        tags.push(t);
+    });
+
+    uint64_t dropped = queue.dropped();
+    if (dropped != tag_drops_reported[index])
+    {
+        RCLCPP_WARN(this->get_logger(), 
+            "agent %s dropped %lu tags (%lu in total)", swarm.names[index].c_str(), 
+            dropped - tag_drops_reported[index], dropped);
+        tag_drops_reported[index] = dropped;
+    }
+}
+
 void cs2::cs2_application::tag_timer_callback()
 {
-    std::map<std::string, tag_queue>::iterator it;
     // We need to handle both task elements and relocalization
     // Iterate through the agents
 
-    for (it = agents_tag_queue.begin(); 
-        it != agents_tag_queue.end(); it++)
+    for (size_t index = 0; index < swarm.size(); index++)
     {
-        rclcpp::Time tag_start = clock.now();
+        auto tag_start = std::chrono::steady_clock::now();
+
+        // take the tags at once, the tag callbacks keep writing the ring
+        std::queue<tag> tags;
+        drain_tags(index, tags);
 
         // Continue if there are no tags
-        if (it->second.t_queue.empty())
+        if (tags.empty())
             continue;
 
-        // Continue if there is no agent to represent
-        auto agent_it = agents_states.find(it->first);
-        if (agent_it == agents_states.end())
-            continue;
+        bool is_tracking;
+        {
+            std::lock_guard<std::mutex> lock(planning_mutex);
+            is_tracking = swarm.flight_state[index] == INTERNAL_TRACKING;
+        }
 
         bool tag_saved = false;
         bool trigger_localize = false;
         tag save_tag;
 
-        // Continue if there is no agent to represent
-        auto fact_it = agents_loop_closure.find(it->first);
-        if (fact_it == agents_loop_closure.end())
-            continue;
+        factor_graph &graph = agents_loop_closure[index];
 
         while(1)
         {
-            std::queue<agent_state> copy = it->second.s_queue;
             // Processed all the tags in the queue
-            if (it->second.t_queue.empty())
+            if (tags.empty())
                 break;
             
-            auto it_eliminate = april_eliminate.find(it->second.t_queue.front().id);
+            auto it_eliminate = april_eliminate.find(tags.front().id);
             if (it_eliminate != april_eliminate.end() && 
-                !tag_saved && agent_it->second.flight_state != INTERNAL_TRACKING)
+                !tag_saved && !is_tracking)
             {
-                save_tag = it->second.t_queue.front();
+                save_tag = tags.front();
                 tag_saved = true;
             }
 
-            auto it_relocate = april_relocalize.find(it->second.t_queue.front().id);
-            
-            if (it_relocate != april_relocalize.end())
+            if (landmarks.find(tags.front().id) != nullptr)
             {
-                if (handle_relocalize(copy, it->second.t_queue.front(), 
-                    it_relocate, it->first))
+                if (handle_relocalize(tags.front(), index))
                 {
                     trigger_localize = true;
                     // RCLCPP_INFO(this->get_logger(), 
                     //     "agent %s handling tag %d", 
-                    //     it->first.c_str(), it->second.t_queue.front().id);
+                    //     swarm.names[index].c_str(), tags.front().id);
                 }
                 else
                 {
                     // RCLCPP_ERROR(this->get_logger(), 
                     //     "agent %s cannot relocalize tag %d", 
-                    //     it->first.c_str(), it->second.t_queue.front().id);
+                    //     swarm.names[index].c_str(), tags.front().id);
                 }
             }
             
-            it->second.t_queue.pop();
+            tags.pop();
         }   
 
         // handle eliminate
         if (tag_saved)
         {
-            handle_eliminate(agent_it, save_tag);
+            handle_eliminate(index, save_tag);
         }
         
-        NamedPoseArray pose_correction;
-        
-        // handle relocalization
-        if (trigger_localize && 
-            fact_it->second.observations.size() > observation_limit)
+        // handle relocalization, the new observations are posted to the
+        // smoother of the agent and this returns at once
+        if (trigger_localize && !graph.observations.empty() && !joint_relocalization)
+            post_relocalization(index);
+
+        stage_latency[TAG_HANDLE].record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - tag_start).count());
+    }
+
+    // one solve for the observations of every agent
+    if (joint_relocalization)
+        post_joint_relocalization();
+}
+
+void cs2::cs2_application::post_relocalization(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(relocalization_mutex);
+        // one update per agent at a time, the observations keep collecting
+        if (relocalization_busy[index])
+            return;
+        relocalization_busy[index] = 1;
+    }
+
+    // the job owns the new observations, the earlier ones are in the smoother
+    auto observations = std::make_shared<factor_graph>();
+    std::swap(observations->observations, agents_loop_closure[index].observations);
+
+    rclcpp::Time posted = clock.now();
+    relocalization_queue->post([this, index, observations, posted]()
+    {
+        rclcpp::Time start = clock.now();
+
+        Eigen::Affine3d pose_opt;
+        if (gtsam_pose_optimization(*observations, pose_opt, index))
+            publish_pose_correction(index, pose_opt);
+
+        rclcpp::Time end = clock.now();
+        stage_latency[RELOCALIZATION_WAIT].record((start - posted).nanoseconds());
+        stage_latency[RELOCALIZATION_SOLVE].record((end - start).nanoseconds());
+
+        std::lock_guard<std::mutex> lock(relocalization_mutex);
+        relocalization_busy[index] = 0;
+    });
+}
+
+void cs2::cs2_application::post_joint_relocalization()
+{
+    auto observations = std::make_shared<std::vector<std::pair<size_t, factor_graph>>>();
+    {
+        std::lock_guard<std::mutex> lock(relocalization_mutex);
+        // one joint update at a time, the observations keep collecting
+        if (joint_relocalization_busy)
+            return;
+
+        for (size_t index = 0; index < swarm.size(); index++)
         {
-            Eigen::Affine3d pose_opt;
-            gtsam_pose_optimization(pose_opt, fact_it, agent_it);
-
-            // get current time
-            auto time = clock.now();
-            pose_correction.header.stamp = time;
-
-            Eigen::Vector3d trans = pose_opt.translation();
-            Eigen::Quaterniond quat(pose_opt.linear());
-
-            TransformStamped msg2;
-            msg2.header.frame_id = "/world";
-            msg2.header.stamp = time;
-            msg2.child_frame_id = "slam" + it->first;
-            msg2.transform.translation.x = trans.x();
-            msg2.transform.translation.y = trans.y();
-            msg2.transform.translation.z = trans.z();
-            msg2.transform.rotation.w = quat.w();
-            msg2.transform.rotation.x = quat.x();
-            msg2.transform.rotation.y = quat.y();
-            msg2.transform.rotation.z = quat.z();
-            tf2_bc.sendTransform(msg2);
-
-            // clear previous observations if over limit
-            fact_it->second.observations.clear();
-
-            NamedPose pose;
-            pose.name = it->first;
-            pose.pose.position.x = trans.x();
-            pose.pose.position.y = trans.y();
-            pose.pose.position.z = trans.z();
-
-            pose.pose.orientation.x = quat.x();
-            pose.pose.orientation.y = quat.y();
-            pose.pose.orientation.z = quat.z();
-            pose.pose.orientation.w = quat.w();
-
-            pose_correction.poses.emplace_back(pose);
+            if (agents_loop_closure[index].observations.empty())
+                continue;
+            observations->emplace_back(index, factor_graph());
+            std::swap(observations->back().second.observations, 
+                agents_loop_closure[index].observations);
         }
 
-        // publish external pose correction
-        if (!pose_correction.poses.empty())
-            pose_publisher->publish(pose_correction);
-
-        // Clear the state queue so that state subscriber can update
-        while(!it->second.s_queue.empty()) 
-            it->second.s_queue.pop();
-        
-        RCLCPP_INFO(this->get_logger(), 
-            "agent %s tag_handle_time %.3lfms", it->first.c_str(), 
-            (clock.now() - tag_start).seconds() * 1000);   
+        if (observations->empty())
+            return;
+        joint_relocalization_busy = true;
     }
-    
+
+    rclcpp::Time posted = clock.now();
+    relocalization_queue->post([this, observations, posted]()
+    {
+        rclcpp::Time start = clock.now();
+
+        std::vector<std::pair<size_t, smoother_state>> states;
+        std::vector<smoother_state> agent_states;
+        for (const auto &[index, graph] : *observations)
+        {
+            agent_states.clear();
+            build_smoother_states(graph, agent_states);
+            for (auto &state : agent_states)
+                states.emplace_back(index, std::move(state));
+        }
+
+        joint_smoother->update(states);
+
+        for (const auto &[index, graph] : *observations)
+        {
+            if (joint_smoother->size(index) <= (size_t)observation_limit)
+                continue;
+
+            Eigen::Vector3d translation_error_average;
+            Eigen::Quaterniond rotation_error_average;
+            if (!joint_smoother->correction(index, 
+                translation_error_average, rotation_error_average))
+                continue;
+            publish_pose_correction(index, corrected_pose(index, 
+                translation_error_average, rotation_error_average));
+        }
+
+        rclcpp::Time end = clock.now();
+        stage_latency[RELOCALIZATION_WAIT].record((start - posted).nanoseconds());
+        stage_latency[RELOCALIZATION_SOLVE].record((end - start).nanoseconds());
+
+        std::lock_guard<std::mutex> lock(relocalization_mutex);
+        joint_relocalization_busy = false;
+    });
+}
+
+void cs2::cs2_application::publish_pose_correction(
+    size_t index, const Eigen::Affine3d &pose_opt)
+{
+    auto pose_correction = std::make_unique<NamedPoseArray>();
+
+    // get current time
+    auto time = clock.now();
+    pose_correction->header.stamp = time;
+
+    Eigen::Vector3d trans = pose_opt.translation();
+    Eigen::Quaterniond quat(pose_opt.linear());
+
+    TransformStamped msg2;
+    msg2.header.frame_id = "/world";
+    msg2.header.stamp = time;
+    msg2.child_frame_id = "slam" + swarm.names[index];
+    msg2.transform.translation.x = trans.x();
+    msg2.transform.translation.y = trans.y();
+    msg2.transform.translation.z = trans.z();
+    msg2.transform.rotation.w = quat.w();
+    msg2.transform.rotation.x = quat.x();
+    msg2.transform.rotation.y = quat.y();
+    msg2.transform.rotation.z = quat.z();
+    tf2_bc.sendTransform(msg2);
+
+    NamedPose pose;
+    pose.name = swarm.names[index];
+    pose.pose.position.x = trans.x();
+    pose.pose.position.y = trans.y();
+    pose.pose.position.z = trans.z();
+
+    pose.pose.orientation.x = quat.x();
+    pose.pose.orientation.y = quat.y();
+    pose.pose.orientation.z = quat.z();
+    pose.pose.orientation.w = quat.w();
+
+    pose_correction->poses.emplace_back(pose);
+
+    // publish external pose correction
+    pose_publisher->publish(std::move(pose_correction));
 }
 
-void cs2::cs2_application::handle_eliminate(
-    std::map<std::string, agent_state>::iterator s, tag t)
+void cs2::cs2_application::handle_eliminate(size_t index, tag t)
 {
+    std::lock_guard<std::mutex> lock(planning_mutex);
+
     RCLCPP_INFO(this->get_logger(), 
-        "agent %s handle eliminate for tag %d", s->first.c_str(), t.id);   
+        "agent %s handle eliminate for tag %d", swarm.names[index].c_str(), t.id);   
 
     // if agent state is IDLE TAKEOFF or LAND, return
-    if (s->second.flight_state == TAKEOFF || 
-        s->second.flight_state == IDLE ||
-        s->second.flight_state == LAND)
+    if (swarm.flight_state[index] == TAKEOFF || 
+        swarm.flight_state[index] == IDLE ||
+        swarm.flight_state[index] == LAND)
         return;
     
     // distance rejection
@@ -277,58 +396,36 @@ void cs2::cs2_application::handle_eliminate(
     if (tag_it == april_eliminate.end())
         return;
 
-    s->second.flight_state = INTERNAL_TRACKING;
+    swarm.flight_state[index] = INTERNAL_TRACKING;
 
     // find the position of the tag and move towards it
-    while (!s->second.target_queue.empty()) 
-        s->second.target_queue.pop();
-    // Eigen::Affine3d tag_to_world = s->second.transform * 
+    while (!swarm.target_queue[index].empty()) 
+        swarm.target_queue[index].pop();
+    // Eigen::Affine3d tag_to_world = swarm.transform(index) * 
     //     static_camera_transform * t.transform;
     
     // world -> body body -> tag 
-    Eigen::Affine3d tag_to_world = 
-        s->second.transform * t.transform;
+    Eigen::Affine3d world_to_body = swarm.latest_transform(index);
+    Eigen::Affine3d tag_to_world = world_to_body * t.transform;
     
-    s->second.target_queue.push(Eigen::Vector3d(
+    swarm.target_queue[index].push(Eigen::Vector3d(
         tag_to_world.translation().x(),
         tag_to_world.translation().y(),
-        s->second.transform.translation().z()));
+        world_to_body.translation().z()));
 
     // erase the tag since we handled it
     april_eliminate.erase(tag_it);
 }
 
-bool cs2::cs2_application::handle_relocalize(
-    std::queue<agent_state> &q, tag t, 
-    std::map<int, Eigen::Vector2d>::iterator tag_pose,
-    std::string agent_id)
+bool cs2::cs2_application::handle_relocalize(tag t, size_t index)
 {
-    double eps = pow(10, -5);
-    double time_threshold_copy = time_threshold;
-    agent_state selected_agent_state; 
-
-    while (!q.empty())
-    {
-        double time_difference = abs((q.front().t - t.t).seconds());
-        // RCLCPP_INFO(this->get_logger(), 
-        //     "time_difference tag %d (%.3lfs/%.3lfs)", t.id, time_difference, time_threshold_copy);
-        
-        // Accept if within a threshold
-        if (time_difference < time_threshold_copy)
-        {
-            selected_agent_state = q.front();
-            time_threshold_copy = time_difference;
-        }
-        q.pop();
-    }
-
-    // If there is no acceptable relocalization topic found
-    if (abs(time_threshold_copy - time_threshold) < eps)
+    // pose at the tag stamp, interpolated from the poses around it
+    pose_sample selected;
+    if (!agents_pose_history[index].sample_at(t.t.nanoseconds(), 
+        static_cast<int64_t>(time_threshold * 1e9), selected))
         return false;
 
-    auto loop_it = agents_loop_closure.find(agent_id);
-    if (loop_it == agents_loop_closure.end())
-        return false;
+    factor_graph &graph = agents_loop_closure[index];
 
     bool found = false;
     // milliseconds
@@ -336,8 +433,8 @@ bool cs2::cs2_application::handle_relocalize(
         static_cast<long>(std::round((t.t - start_node_time).seconds() * 1000));
 
     // iterate through to find any observations that have around the same time stamp
-    for (auto it = loop_it->second.observations.begin(); 
-        it != loop_it->second.observations.end(); it++)
+    for (auto it = graph.observations.begin(); 
+        it != graph.observations.end(); it++)
     {
         // if time stamp is found within threshold, add in this marker
         if (abs((it->first - milli_time)) < time_threshold/2)
@@ -353,9 +450,12 @@ bool cs2::cs2_application::handle_relocalize(
     {
         observation obs;
         obs.marker.push(t);
-        obs.pose = selected_agent_state.transformEigen2Gtsam();
+        obs.pose = gtsam::Pose3(
+            gtsam::Rot3::Quaternion(selected.orientation[0], selected.orientation[1],
+                selected.orientation[2], selected.orientation[3]),
+            gtsam::Point3{selected.position[0], selected.position[1], selected.position[2]});
 
-        loop_it->second.observations.insert({milli_time, obs});
+        graph.observations.insert({milli_time, obs});
     }
 
     // selected_agent_state.transform * static_camera_transform * t.transform 
@@ -366,161 +466,99 @@ bool cs2::cs2_application::handle_relocalize(
     // Eigen::Vector3d trans = tag_to_world.translation();
             
     // RCLCPP_INFO(this->get_logger(), 
-    //     "(tag_to_world) tag %d (%.3lf, %.3lf, %.3lf) (%.3lf, %.3lf)", 
-    //     tag_pose->first, trans.x(), trans.y(), trans.z(),
-    //     tag_pose->second.x(), tag_pose->second.y());
+    //     "(tag_to_world) tag %d (%.3lf, %.3lf, %.3lf)", 
+    //     t.id, trans.x(), trans.y(), trans.z());
 
     return true;
 }
 
-void cs2::cs2_application::gtsam_pose_optimization(
-    Eigen::Affine3d &pose, 
-    std::map<std::string, factor_graph>::iterator fact_it,
-    std::map<std::string, agent_state>::iterator agent_it)
+void cs2::cs2_application::build_smoother_states(
+    const factor_graph &fact, std::vector<smoother_state> &states) const
 {
-    gtsam::NonlinearFactorGraph graph;
-    gtsam::Values initial;
-    
     // factor graph: X state, Z are measurements
     // X1 -> X2 -> X3
     // |     |     |
     // v     v     v
     // Z1    Z2    Z3
+    // only the new X and Z go in, the smoother keeps the rest
 
-    double rSigma = 0.03;
-    double tSigma = 0.02;
-
-    auto noise = gtsam::noiseModel::Diagonal::Sigmas(
-        gtsam::Vector6::Constant(rSigma));
-
-    gtsam::Pose3 previous_pose;
-
-    uint32_t id = 0;
+    states.reserve(states.size() + fact.observations.size());
 
-    for (auto it = fact_it->second.observations.begin(); 
-        it != fact_it->second.observations.end(); it++)
+    for (auto it = fact.observations.begin(); 
+        it != fact.observations.end(); it++)
     {
-        uint8_t idx = std::distance(
-            fact_it->second.observations.begin(), it);
-
-        bool update_x = false;
-
-        gtsam::Pose3 wtb;
-
-        // Eigen::Affine3d agent_to_world;
-        // agent_to_world.translation() = 
-        //     Eigen::Vector3d(it->second.pose.x(),
-        //     it->second.pose.y(), it->second.pose.z());
-
-        // agent_to_world.linear() = it->second.pose.rotation().matrix();
-
         std::queue<tag> copy = it->second.marker;
 
         if (copy.empty())
             continue;
+
+        smoother_state state;
+        state.recorded = it->second.pose;
         
         while (!copy.empty())
         {
-            // uint8_t id = copy.front().id;
-
-            // RCLCPP_INFO(this->get_logger(), 
-            //     "tag_id %d state_id %d", id, idx);
-
-            auto it_reloc = 
-                april_relocalize.find(copy.front().id);
-
-            Eigen::Affine3d world_to_tag = nwu_to_enu;
-            world_to_tag.translation() = Eigen::Vector3d(
-                it_reloc->second.x(), it_reloc->second.y(), 0.0);
+            const landmark *l = landmarks.find(copy.front().id);
+            if (l == nullptr)
+            {
+                copy.pop();
+                continue;
+            }
 
             // estimated pose - back track from camera absolute pos
-            if (!update_x)
+            if (state.landmarks.empty())
             {
                 // world -> tag tag -> camera camera -> body
-                Eigen::Affine3d world_to_body = world_to_tag * 
+                Eigen::Affine3d world_to_body = l->world_to_tag * 
                     copy.front().transform.inverse() * static_camera_transform.inverse();
                 
                 tag world_to_body_tag;
                 world_to_body_tag.transform = world_to_body;
-                wtb = world_to_body_tag.transformEigen2Gtsam();
-
-                initial.insert(X(idx), wtb);
-                update_x = true;
-            }            
-
-            gtsam::Pose3 prior(
-                gtsam::Rot3(nwu_to_enu.linear()), 
-                gtsam::Point3{it_reloc->second.x(), it_reloc->second.y(), 0.0});
-
-            graph.addPrior(Z(id), prior, noise);
+                state.initial = world_to_body_tag.transformEigen2Gtsam();
+            }
 
             // tag to body
-            graph.add(gtsam::BetweenFactor<gtsam::Pose3>(
-                X(idx), Z(id), copy.front().transformEigen2Gtsam(), noise));
-
-            initial.insert(Z(id), prior);
+            state.landmarks.emplace_back(l, copy.front().transformEigen2Gtsam());
 
             copy.pop();
-
-            id++;
         }
 
-        // since it is the beginning of the vector, do not add the between factor
-        if (it == fact_it->second.observations.begin())
-        {
-            previous_pose = wtb;
+        if (state.landmarks.empty())
             continue;
-        }
-        
-        // z(i-1) -> z(i)
-        gtsam::Pose3 relative_pose = 
-            previous_pose.inverse() * wtb;
 
-        graph.add(gtsam::BetweenFactor<gtsam::Pose3>(
-            X(idx-1), X(idx), relative_pose, noise));
-        
-        previous_pose = wtb;
+        states.push_back(std::move(state));
     }
+}
 
-    gtsam::LevenbergMarquardtParams params;
-
-    auto optimizer =
-        gtsam::LevenbergMarquardtOptimizer(graph, initial, params);
-
-    // optimizeSafely is inherited
-    auto result = optimizer.optimizeSafely();
+Eigen::Affine3d cs2::cs2_application::corrected_pose(size_t index, 
+    const Eigen::Vector3d &translation_error, 
+    const Eigen::Quaterniond &rotation_error) const
+{
+    Eigen::Affine3d current = swarm.latest_transform(index);
+    Eigen::Quaterniond q(current.linear());
 
-    std::vector<Eigen::Vector4f> quaternions_error_vector;
-    size_t div = fact_it->second.observations.size();
-    Eigen::Vector3d translation_error_average = 
-        Eigen::Vector3d::Zero();
-    for (auto it = fact_it->second.observations.begin(); 
-        it != fact_it->second.observations.end(); it++)
-    {
-        uint8_t idx = std::distance(
-            fact_it->second.observations.begin(), it);
-        
-        gtsam::Pose3 opt_pose = result.at<gtsam::Pose3>(X(idx));
-        translation_error_average += Eigen::Vector3d(
-            opt_pose.x() - it->second.pose.x(), 
-            opt_pose.y() - it->second.pose.y(),
-            opt_pose.z() - it->second.pose.z());
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+    pose.translation() = translation_error + current.translation();
+    pose.linear() = (rotation_error * q).toRotationMatrix();
+    return pose;
+}
 
-        Eigen::Quaterniond q_curr(it->second.pose.rotation().matrix());
-        Eigen::Quaterniond q_opt(opt_pose.rotation().matrix());
+bool cs2::cs2_application::gtsam_pose_optimization(
+    const factor_graph &fact, Eigen::Affine3d &pose, size_t index)
+{
+    std::vector<smoother_state> states;
+    build_smoother_states(fact, states);
 
-        // get the difference/error in quaternions
-        Eigen::Quaterniond q_diff = q_opt * q_curr.inverse();
+    pose_smoother &smoother = agents_smoother[index];
+    smoother.update(states);
 
-        quaternions_error_vector.emplace_back(quat_to_vec4(q_diff));
-    }
+    if (smoother.size() <= (size_t)observation_limit)
+        return false;
 
-    Eigen::Vector4f quat = 
-        quaternion_average(quaternions_error_vector);
-    translation_error_average /= (double)div;
+    Eigen::Vector3d translation_error_average;
+    Eigen::Quaterniond rotation_error_average;
+    if (!smoother.correction(translation_error_average, rotation_error_average))
+        return false;
 
-    Eigen::Quaterniond q(agent_it->second.transform.linear());
-    
-    pose.translation() = translation_error_average + agent_it->second.transform.translation();
-    pose.linear() = (vec4_to_quat(quat) * q).toRotationMatrix();
-}
\ No newline at end of file
+    pose = corrected_pose(index, translation_error_average, rotation_error_average);
+    return true;
+}
@@ -18,78 +18,368 @@
 
 #include "crazyswarm_app.h"
 
-void cs2::cs2_application::conduct_planning(
-    Eigen::Vector3d &desired, std::string mykey, agent_state state) 
+void cs2::cs2_application::rebuild_neighbour_index()
 {
-    auto it = rvo_agents.find(mykey);
-    if (it == rvo_agents.end())
-        return;
-
-    // Construct KD-tree
-    kd_tree = kd_create(3);
-    for (auto &[key, agent] : agents_states)
-    { 
-        if (strcmp(mykey.c_str(), key.c_str()) == 0)
+    scoped_latency timed(stage_latency[NEIGHBOUR_INDEX]);
+
+    // snapshot of the swarm that every agent plans against in this tick,
+    // the callbacks keep writing their seqlocks while this is taken
+    swarm.snapshot();
+    for (size_t i = 0; i < swarm.size(); i++)
+        planner->set_state(i, swarm.position[i], swarm.velocity[i]);
+
+    planner->rebuild_neighbour_index();
+}
+
+void cs2::cs2_application::plan_swarm_velocities()
+{
+    trace_commands(velocity_commands);
+
+    scoped_latency timed(stage_latency[ORCA_SOLVE]);
+    planner->plan(velocity_commands);
+}
+
+void cs2::cs2_application::trace_commands(
+    std::vector<velocity_command> &commands) const
+{
+    for (auto &command : commands)
+    {
+        size_t i = command.index;
+        // no pose has come in yet, the agent plans from its initial position
+        if (swarm.sequence[i] == 0)
             continue;
-        Eval_agent *node = new Eval_agent;
-        node->position_ = agent.transform.translation().cast<float>();
-        node->velocity_ = agent.velocity.cast<float>();
-        node->radius_ = (float)protected_zone;
-        int v = kd_insert3(
-            kd_tree, node->position_.x(), 
-            node->position_.y(), node->position_.z(),
-            node);
+        command.trace.stamp = swarm.t[i].nanoseconds();
+        command.trace.sequence = swarm.sequence[i];
+        command.trace.received = swarm.received[i];
+    }
+}
+
+common::velocity_command cs2::cs2_application::velocity_towards(
+    size_t index, const Eigen::Vector3d &target) const
+{
+    Eigen::Vector3d difference = target - swarm.position[index];
+
+    // close to the target the velocity is scaled down and not planned
+    if (difference.norm() < max_velocity)
+        return {index, difference, target.z(), false};
+    
+    return {index, difference.normalized() * max_velocity, target.z(), true};
+}
+
+void cs2::cs2_application::notify_pose_event(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(event_mutex);
+        // a pose that comes before the last one is planned replaces it
+        if (event_pending[index])
+            return;
+        event_pending[index] = 1;
+        event_pending_count++;
     }
+    event_cv.notify_one();
+}
+
+void cs2::cs2_application::event_planning_loop()
+{
+    using std::chrono::steady_clock;
+    const steady_clock::duration min_period = 
+        std::chrono::duration_cast<steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / event_planning_rate));
+
+    std::vector<size_t> batch;
+    std::unique_lock<std::mutex> lock(event_mutex);
+
+    while (true)
+    {
+        event_cv.wait(lock, [this] { return event_stop || event_pending_count > 0; });
+        if (event_stop)
+            return;
+
+        // take every pending agent that is not over its rate cap
+        steady_clock::time_point now = steady_clock::now();
+        steady_clock::time_point next_due = steady_clock::time_point::max();
+        batch.clear();
+        for (size_t i = 0; i < event_pending.size(); i++)
+        {
+            if (!event_pending[i])
+                continue;
+            steady_clock::time_point due = event_last_plan[i] + min_period;
+            if (now < due)
+            {
+                next_due = std::min(next_due, due);
+                continue;
+            }
+            event_pending[i] = 0;
+            event_pending_count--;
+            event_last_plan[i] = now;
+            batch.push_back(i);
+        }
 
-    struct kdres *neighbours;
-    neighbours = kd_nearest_range3(
-        kd_tree, state.transform.translation().x(), 
-        state.transform.translation().y(), 
-        state.transform.translation().z(),
-        communication_radius);
+        if (batch.empty())
+        {
+            event_cv.wait_until(lock, next_due);
+            continue;
+        }
 
-    float communication_radius_float = (float)communication_radius;
+        lock.unlock();
+        plan_pose_events(batch);
+        lock.lock();
+    }
+}
+
+void cs2::cs2_application::plan_pose_events(const std::vector<size_t> &batch)
+{
+    std::lock_guard<std::mutex> lock(planning_mutex);
 
-    // clear agent neighbour before adding in new neighbours and obstacles
-    it->second.clearAgentNeighbor();
+    // same pipeline as the planning tick, for the agents with a fresh pose
+    rebuild_neighbour_index();
 
-    while (!kd_res_end(neighbours))
+    event_commands.clear();
+    for (size_t i : batch)
     {
-        double pos[3];
-        Eval_agent *agent = (Eval_agent*)kd_res_item(neighbours, pos);
+        if (swarm.flight_state[i] != MOVE_VELOCITY && 
+            swarm.flight_state[i] != INTERNAL_TRACKING)
+            continue;
+
+        // flown onboard, the handler tick looks after the stream
+        if (trajectory_upload && swarm.flight_state[i] == MOVE_VELOCITY)
+            continue;
         
-        it->second.insertAgentNeighbor(*agent, communication_radius_float);
-        // store range query result so that we dont need to query again for rewire;
-        kd_res_next(neighbours); // go to next in kd tree range query result
+        const std::queue<Eigen::Vector3d> &target_queue = swarm.target_queue[i];
+        // reaching the target is left to the handler tick that pops it
+        if (target_queue.empty() || 
+            (target_queue.front() - swarm.position[i]).norm() < reached_threshold)
+            continue;
+
+        event_commands.push_back(velocity_towards(i, target_queue.front()));
     }
 
-    kd_free(kd_tree);
+    trace_commands(event_commands);
+    {
+        scoped_latency timed(stage_latency[ORCA_SOLVE]);
+        planner->plan(event_commands);
+    }
+    publish_velocity_commands(event_commands);
+}
+
+double cs2::cs2_application::command_urgency_of(
+    const velocity_command &command) const
+{
+    size_t i = command.index;
+
+    // 1 inside the protected zone of a neighbour
+    double proximity = protected_zone / 
+        std::max(planner->nearest_neighbour(i), protected_zone);
+
+    const Eigen::Vector3d &target = swarm.target_queue[i].empty() ?
+        swarm.previous_target[i] : swarm.target_queue[i].front();
+    // 1 on the target, where the agent has to stop
+    double arrival = 1.0 / (1.0 + (target - swarm.position[i]).norm());
+
+    return proximity + arrival;
+}
+
+void cs2::cs2_application::publish_velocity_commands(
+    const std::vector<velocity_command> &commands)
+{
+    scoped_latency timed(stage_latency[COMMAND_PUBLISH]);
 
-    if (!it->second.noNeighbours())
+    scheduled_commands = commands;
+    command_urgency.clear();
+    for (const auto &command : scheduled_commands)
+        command_urgency.push_back(command_urgency_of(command));
+
+    uint64_t deferred = velocity_scheduler->deferred();
+    velocity_scheduler->schedule(scheduled_commands, command_urgency, 
+        std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    if (velocity_scheduler->deferred() > deferred)
+        RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 10000, 
+            "radio budget deferred %lu velocity commands", 
+            (unsigned long)(velocity_scheduler->deferred() - deferred));
+
+    rclcpp::Time now = clock.now();
+    int64_t steady_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    for (auto &command : scheduled_commands)
     {
-        agent_update_mutex.lock();
-        it->second.updateState(
-            state.transform.translation().cast<float>(), 
-            state.velocity.cast<float>(), 
-            desired.cast<float>());
-        agent_update_mutex.unlock();
-
-        it->second.computeNewVelocity();
-        Eigen::Vector3f new_desired = it->second.getVelocity();
-        desired = new_desired.cast<double>();
+        const command_trace &trace = command.trace;
+        auto vel_msg = std::make_unique<VelocityWorld>();
+        // stamped with the pose the command was planned from, so that the
+        // command can be matched to its mocap frame downstream
+        vel_msg->header.stamp = trace.sequence > 0 ? 
+            rclcpp::Time(trace.stamp, now.get_clock_type()) : now;
+        vel_msg->vel.x = command.velocity.x();
+        vel_msg->vel.y = command.velocity.y();
+        vel_msg->vel.z = command.velocity.z();
+        vel_msg->height = command.height;
+        vel_msg->yaw = 0.0;
+        agents_comm[command.index].vel_world_publisher->publish(std::move(vel_msg));
+
+        if (trace.sequence == 0)
+            continue;
+
+        int64_t latency = now.nanoseconds() - trace.stamp;
+        agent_trace &t = agents_trace[command.index];
+        t.latency.record(latency);
+        t.staleness.record(steady_now - trace.received);
+        // a keep alive or a tick faster than the mocap sends the pose again
+        if (trace.sequence == t.last_sequence)
+            t.repeated++;
+        t.last_sequence = trace.sequence;
+
+        CS2_TRACEPOINT(command_published, (uint32_t)command.index, 
+            trace.sequence, trace.stamp, latency);
     }
 }
 
+void cs2::cs2_application::record_planning_jitter()
+{
+    using std::chrono::steady_clock;
+    steady_clock::time_point now = steady_clock::now();
+    tick_jitter &j = planning_jitter;
+
+    if (j.started)
+    {
+        double period = std::chrono::duration<double>(now - j.last).count();
+        stage_latency[PLANNING_JITTER].record(
+            (int64_t)(std::abs(period - 1.0 / planning_rate) * 1e9));
+    }
+    j.last = now;
+    j.started = true;
+}
+
+void cs2::cs2_application::diagnostics_timer_callback()
+{
+    static const char *stage_names[LATENCY_STAGES] = {
+        "pose ingestion", "neighbour index", "orca solve", "command publish",
+        "planning jitter", "tag callback", "tag handle", "relocalization wait",
+        "relocalization solve", "mission dispatch"};
+
+    auto key_value = [](const std::string &key, const std::string &value)
+    {
+        KeyValue kv;
+        kv.key = key;
+        kv.value = value;
+        return kv;
+    };
+
+    auto diagnostics = std::make_unique<DiagnosticArray>();
+    diagnostics->header.stamp = clock.now();
+
+    char buffer[64];
+    for (size_t stage = 0; stage < LATENCY_STAGES; stage++)
+    {
+        latency_histogram::summary s = stage_latency[stage].collect();
+
+        DiagnosticStatus status;
+        status.level = DiagnosticStatus::OK;
+        status.name = std::string(this->get_name()) + ": " + stage_names[stage];
+        status.hardware_id = this->get_name();
+        snprintf(buffer, sizeof(buffer), "p99 %.3lfms", s.p99);
+        status.message = buffer;
+        status.values.push_back(key_value("count", std::to_string(s.count)));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.p50);
+        status.values.push_back(key_value("p50_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.p90);
+        status.values.push_back(key_value("p90_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.p99);
+        status.values.push_back(key_value("p99_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.max);
+        status.values.push_back(key_value("max_ms", buffer));
+        diagnostics->status.push_back(status);
+    }
+
+    // the repeats and the scheduler counts are written under the planning
+    // mutex, all of them are totals since the start
+    std::vector<uint64_t> repeated(swarm.size());
+    uint64_t suppressed, deferred;
+    {
+        std::lock_guard<std::mutex> lock(planning_mutex);
+        for (size_t i = 0; i < swarm.size(); i++)
+            repeated[i] = agents_trace[i].repeated;
+        suppressed = velocity_scheduler->suppressed();
+        deferred = velocity_scheduler->deferred();
+    }
+
+    for (size_t i = 0; i < swarm.size(); i++)
+    {
+        latency_histogram::summary l = agents_trace[i].latency.collect();
+        latency_histogram::summary s = agents_trace[i].staleness.collect();
+
+        DiagnosticStatus status;
+        status.level = DiagnosticStatus::OK;
+        status.name = std::string(this->get_name()) + ": " + 
+            swarm.names[i] + " pose to command";
+        status.hardware_id = swarm.names[i];
+        snprintf(buffer, sizeof(buffer), "p99 %.3lfms", l.p99);
+        status.message = buffer;
+        status.values.push_back(key_value("count", std::to_string(l.count)));
+        snprintf(buffer, sizeof(buffer), "%.3lf", l.p50);
+        status.values.push_back(key_value("latency_p50_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", l.p99);
+        status.values.push_back(key_value("latency_p99_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", l.max);
+        status.values.push_back(key_value("latency_max_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.p50);
+        status.values.push_back(key_value("staleness_p50_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.p99);
+        status.values.push_back(key_value("staleness_p99_ms", buffer));
+        snprintf(buffer, sizeof(buffer), "%.3lf", s.max);
+        status.values.push_back(key_value("staleness_max_ms", buffer));
+        status.values.push_back(key_value("repeated_poses", std::to_string(repeated[i])));
+        diagnostics->status.push_back(status);
+    }
+
+    // counters of the queues and the command stream, totals since the start
+    uint64_t tag_drops = 0;
+    for (const tag_queue &queue : agents_tag_queue)
+        tag_drops += queue.dropped();
+
+    DiagnosticStatus counters;
+    counters.level = DiagnosticStatus::OK;
+    counters.name = std::string(this->get_name()) + ": counters";
+    counters.hardware_id = this->get_name();
+    counters.values.push_back(key_value("tag_drops", std::to_string(tag_drops)));
+    counters.values.push_back(key_value("relocalization_queue_depth", 
+        std::to_string(relocalization_queue->depth())));
+    counters.values.push_back(key_value("velocity_suppressed", std::to_string(suppressed)));
+    counters.values.push_back(key_value("velocity_deferred", std::to_string(deferred)));
+    diagnostics->status.push_back(counters);
+
+    diagnostics_publisher->publish(std::move(diagnostics));
+}
+
 void cs2::cs2_application::handler_timer_callback() 
 {
-    AgentsStateFeedback agents_feedback;
-    MarkerArray target_array;
+    record_planning_jitter();
+
+    std::lock_guard<std::mutex> lock(planning_mutex);
+
+    // published as unique pointers, moved to the subscribers in the process
+    auto agents_feedback = std::make_unique<AgentsStateFeedback>();
+    auto target_array = std::make_unique<MarkerArray>();
 
-    // Iterate through the agents
-    for (auto &[key, agent] : agents_states)
+    // (1) snapshot the swarm into one neighbour index for this tick
+    rebuild_neighbour_index();
+
+    velocity_commands.clear();
+
+    // (2) run the state machine and collect the velocity commands
+    for (size_t i = 0; i < swarm.size(); i++)
     {
-        rclcpp::Time now = this->get_clock()->now();
-        switch (agent.flight_state)
+        const Eigen::Vector3d &position = swarm.position[i];
+        std::queue<Eigen::Vector3d> &target_queue = swarm.target_queue[i];
+
+        // any other state is flown by a high level command or the stream
+        if (trajectory_upload && swarm.flight_state[i] != MOVE_VELOCITY &&
+            swarm.flight_state[i] != HOVER && 
+            (agents_trajectory[i].active || agents_trajectory[i].streaming))
+            leave_trajectory(i);
+
+        switch (swarm.flight_state[i])
         {
             case IDLE:
             {
@@ -98,119 +388,86 @@ void cs2::cs2_application::handler_timer_callback()
 
             case HOVER: 
             {
+                // the end of the trajectory is held onboard, an agent that
+                // was on the stream is given the hover point to fly to, or
+                // keeps streaming it when the upload cannot be sent
+                if (trajectory_upload && (!agents_trajectory[i].streaming ||
+                    upload_trajectory(i, {swarm.previous_target[i]}, true)))
+                    break;
+
                 double pose_difference = 
-                    (agent.previous_target - agent.transform.translation()).norm();
+                    (swarm.previous_target[i] - position).norm();
 
                 Eigen::Vector3d vel_target;
                 if (pose_difference < max_velocity)
                     vel_target = 
-                        (agent.previous_target - agent.transform.translation()); 
+                        (swarm.previous_target[i] - position); 
                 else
                     vel_target = 
-                        (agent.previous_target - agent.transform.translation()).normalized() * max_velocity;
+                        (swarm.previous_target[i] - position).normalized() * max_velocity;
                 
-                VelocityWorld vel_msg;
-                vel_msg.header.stamp = clock.now();
-                vel_msg.vel.x = vel_target.x();
-                vel_msg.vel.y = vel_target.y();
-                vel_msg.vel.z = vel_target.z();
-                vel_msg.height = agent.previous_target.z();
-                vel_msg.yaw = 0.0;
-                auto it = agents_comm.find(key);
-                if (it != agents_comm.end())
-                    it->second.vel_world_publisher->publish(vel_msg);
+                velocity_commands.push_back(
+                    {i, vel_target, swarm.previous_target[i].z(), false});
                 
-                // agent.completed = false;
+                // swarm.completed[i] = false;
                 break;
             }
             case TAKEOFF: case LAND: case MOVE:
             {
                 bool is_land = 
-                    (agent.flight_state == LAND);
+                    (swarm.flight_state[i] == LAND);
 
-                if (agent.target_queue.empty())
+                if (target_queue.empty())
                 {
                     // we do not need to handle the velocity here since:
                     // cffirmware land service handles it for us
                     // after popping the takeoff/goto queue till it is empty, change state to hover
-                    agent.flight_state = is_land ? IDLE : HOVER;
-                    agent.completed = true;
+                    swarm.flight_state[i] = is_land ? IDLE : HOVER;
+                    swarm.completed[i] = true;
                     break;
                 }
                 double pose_difference = 
-                    (agent.target_queue.front() - agent.transform.translation()).norm();
+                    (target_queue.front() - position).norm();
                 if (pose_difference < reached_threshold)
                 {
-                    agent.previous_target = agent.target_queue.front();
-                    agent.target_queue.pop();
+                    swarm.previous_target[i] = target_queue.front();
+                    target_queue.pop();
                 }
                 break;
             }
             case MOVE_VELOCITY: case INTERNAL_TRACKING:
             {
-                rclcpp::Time start = clock.now();
-
-                if (agent.target_queue.empty())
+                if (target_queue.empty())
                 {
                     // move velocity
-                    if (agent.flight_state == MOVE_VELOCITY)
-                    {
-                        agent.flight_state = HOVER;
-                        agent.completed = true;
-                    }
+                    if (swarm.flight_state[i] == MOVE_VELOCITY)
+                        swarm.flight_state[i] = HOVER;
                     // internal tracking
                     else
-                    {
-                        auto it = agents_comm.find(key);
-                        if (it == agents_comm.end())
-                            continue;
-
-                        send_land_and_update(agents_states.find(key), it);                        
-                        agent.completed = true;
-                    }
+                        send_land_and_update(i);
                     
+                    swarm.completed[i] = true;
                     break;
                 }
                 double pose_difference = 
-                    (agent.target_queue.front() - agent.transform.translation()).norm();
+                    (target_queue.front() - position).norm();
 
-                VelocityWorld vel_msg;
-                Eigen::Vector3d vel_target;
-                vel_msg.height = agent.target_queue.front().z();
+                bool onboard = trajectory_upload && 
+                    swarm.flight_state[i] == MOVE_VELOCITY;
 
                 if (pose_difference < reached_threshold)
                 {
-                    vel_target = Eigen::Vector3d::Zero();
-                    agent.previous_target = agent.target_queue.front();
-                    agent.target_queue.pop();
+                    if (!onboard)
+                        velocity_commands.push_back(
+                            {i, Eigen::Vector3d::Zero(), target_queue.front().z(), false});
+                    swarm.previous_target[i] = target_queue.front();
+                    target_queue.pop();
                 }
-                else if (pose_difference < max_velocity)
-                    vel_target = 
-                        (agent.target_queue.front() - agent.transform.translation()); 
+                else if (onboard)
+                    velocity_commands.push_back(trajectory_command(i));
                 else
-                {
-                    vel_target = 
-                        (agent.target_queue.front() - agent.transform.translation()).normalized() * max_velocity;
-                    conduct_planning(vel_target, key, agent);
-                }
-
-                double duration_seconds = (clock.now() - start).seconds();
-                RCLCPP_INFO(this->get_logger(), "go_to_velocity %s (%.3lf %.3lf %.3lf) time (%.3lfms)", 
-                    key.c_str(), vel_target.x(), vel_target.y(), vel_target.z(), duration_seconds * 1000.0);
-
-                vel_msg.header.stamp = clock.now();
-                vel_msg.vel.x = vel_target.x();
-                vel_msg.vel.y = vel_target.y();
-                vel_msg.vel.z = vel_target.z();
-
-                // check the difference in heading
-                // Eigen::Vector3d rpy = 
-                //     agent.transform.eulerAngles(2,1,0).reverse();
-                vel_msg.yaw = 0.0;
-                
-                auto it = agents_comm.find(key);
-                if (it != agents_comm.end())
-                    it->second.vel_world_publisher->publish(vel_msg);
+                    velocity_commands.push_back(
+                        velocity_towards(i, target_queue.front()));
                 break;
             }
 
@@ -219,16 +476,11 @@ void cs2::cs2_application::handler_timer_callback()
             
         }
 
-        std::string str_copy = key;
-        // Remove cf from cfXX
-        str_copy.erase(0,2);
-        int id = std::stoi(str_copy);
-
         Marker target;
         target.header.frame_id = "/world";
         target.header.stamp = clock.now();
         target.type = visualization_msgs::msg::Marker::LINE_STRIP;
-        target.id = id;
+        target.id = swarm.ids[i];
         target.action = visualization_msgs::msg::Marker::ADD;
         target.pose.orientation.x = 0.0;
         target.pose.orientation.y = 0.0;
@@ -240,15 +492,15 @@ void cs2::cs2_application::handler_timer_callback()
         target.color.b = 1.0;
         target.color.a = 1.0;
 
-        if(!agent.target_queue.empty())
+        if(!target_queue.empty())
         {
             // copy to prevent deleting the main target queue
-            std::queue<Eigen::Vector3d> target_copy = agent.target_queue;
+            std::queue<Eigen::Vector3d> target_copy = target_queue;
 
             Point p;
-            p.x = agent.transform.translation().x();
-            p.y = agent.transform.translation().y();
-            p.z = agent.transform.translation().z();
+            p.x = position.x();
+            p.y = position.y();
+            p.z = position.z();
             target.points.push_back(p);
 
             while (!target_copy.empty())
@@ -264,20 +516,30 @@ void cs2::cs2_application::handler_timer_callback()
         }
 
         AgentState agentstate;
-        agentstate.id = key;
-        agentstate.flight_state = agent.flight_state;
-        agentstate.connected = agent.radio_connection;
-        agentstate.completed = agent.completed;
-        agentstate.mission_capable = agent.mission_capable;
-
-        agents_feedback.agents.push_back(agentstate);
-        target_array.markers.push_back(target);
+        agentstate.id = swarm.names[i];
+        agentstate.flight_state = swarm.flight_state[i];
+        agentstate.connected = swarm.radio_connection[i];
+        agentstate.completed = swarm.completed[i];
+        agentstate.mission_capable = swarm.mission_capable[i];
+
+        agents_feedback->agents.push_back(agentstate);
+        target_array->markers.push_back(target);
     }
 
+    // (3) every agent solves ORCA against the same snapshot
+    plan_swarm_velocities();
+
+    // agents that keep to their trajectory send nothing
+    if (trajectory_upload)
+        separate_trajectory_commands(velocity_commands);
+
+    // (4) send all the velocity commands
+    publish_velocity_commands(velocity_commands);
+
     // publish the flight state message
-    agents_feedback.header.stamp = clock.now();
-    agent_state_publisher->publish(agents_feedback);
+    agents_feedback->header.stamp = clock.now();
+    agent_state_publisher->publish(std::move(agents_feedback));
 
     // publish the target data
-    target_publisher->publish(target_array);
-}
\ No newline at end of file
+    target_publisher->publish(std::move(target_array));
+}
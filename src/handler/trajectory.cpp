@@ -0,0 +1,242 @@
+/*
+* trajectory.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "crazyswarm_app.h"
+
+common::velocity_command cs2::cs2_application::trajectory_command(size_t index)
+{
+    agent_trajectory &a = agents_trajectory[index];
+    const std::queue<Eigen::Vector3d> &target_queue = swarm.target_queue[index];
+
+    if (!a.streaming)
+    {
+        // copy to prevent deleting the main target queue
+        std::queue<Eigen::Vector3d> target_copy = target_queue;
+        std::vector<Eigen::Vector3d> targets;
+        targets.reserve(target_copy.size());
+        while (!target_copy.empty())
+        {
+            targets.push_back(target_copy.front());
+            target_copy.pop();
+        }
+
+        // the popped targets leave the rest of the queue as it was
+        // uploaded, anything else is a new goal
+        bool unchanged = a.active && targets.size() <= a.targets.size() &&
+            a.targets.size() - targets.size() < a.uploaded &&
+            std::equal(targets.begin(), targets.end(), 
+            a.targets.end() - targets.size());
+
+        if (!unchanged)
+            upload_trajectory(index, targets, false);
+    }
+
+    // on the stream, or with no upload service, it is planned as in the
+    // velocity mode
+    if (a.streaming)
+    {
+        velocity_command command = velocity_towards(index, target_queue.front());
+        trajectory_desired[index] = command.velocity;
+        return command;
+    }
+
+    double t = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - a.start).count();
+    trajectory_desired[index] = a.plan.velocity(t);
+
+    return {index, trajectory_desired[index], target_queue.front().z(), true};
+}
+
+void cs2::cs2_application::separate_trajectory_commands(
+    std::vector<velocity_command> &commands)
+{
+    size_t kept = 0;
+    for (size_t c = 0; c < commands.size(); c++)
+    {
+        const velocity_command &command = commands[c];
+        size_t index = command.index;
+
+        if (swarm.flight_state[index] != MOVE_VELOCITY)
+        {
+            commands[kept++] = command;
+            continue;
+        }
+
+        agent_trajectory &a = agents_trajectory[index];
+        double deviation = (command.velocity - trajectory_desired[index]).norm();
+
+        if (a.streaming)
+        {
+            // back onboard from where the agent is now, half the threshold
+            // keeps it from going back and forth, it stays on the stream
+            // until the upload can be sent
+            if (deviation < 0.5 * conflict_threshold)
+            {
+                std::queue<Eigen::Vector3d> target_copy = swarm.target_queue[index];
+                std::vector<Eigen::Vector3d> targets;
+                while (!target_copy.empty())
+                {
+                    targets.push_back(target_copy.front());
+                    target_copy.pop();
+                }
+                if (upload_trajectory(index, targets, true))
+                    continue;
+            }
+            commands[kept++] = command;
+        }
+        else if (deviation > conflict_threshold)
+        {
+            // ORCA predicts a conflict on the trajectory, the stream
+            // takes over until it clears
+            RCLCPP_INFO(this->get_logger(), "agent %s off its trajectory (%.3lfm/s)", 
+                swarm.names[index].c_str(), deviation);
+            a.streaming = true;
+            a.active = false;
+            commands[kept++] = command;
+        }
+    }
+    commands.resize(kept);
+}
+
+bool cs2::cs2_application::upload_trajectory(size_t index, 
+    const std::vector<Eigen::Vector3d> &targets, bool release)
+{
+    agent_trajectory &a = agents_trajectory[index];
+    agent_struct &comm = agents_comm[index];
+
+    if (!comm.upload_trajectory->service_is_ready() ||
+        !comm.start_trajectory->service_is_ready() ||
+        (release && !comm.notify_setpoints_stop->service_is_ready()))
+    {
+        RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 5000, 
+            "agent %s upload_trajectory is not available, streaming velocity", 
+            swarm.names[index].c_str());
+        a.streaming = true;
+        a.active = false;
+        return false;
+    }
+
+    a.uploaded = std::min(targets.size(), trajectory_pieces);
+    std::vector<Eigen::Vector3d> uploaded(targets.begin(), targets.begin() + a.uploaded);
+    a.plan = piecewise_trajectory(swarm.position[index], uploaded, max_velocity, 0.0);
+    a.targets = targets;
+    a.start = std::chrono::steady_clock::now();
+    a.active = true;
+    a.streaming = false;
+    // a stream that starts again goes out at once
+    velocity_scheduler->reset(index);
+
+    // a trajectory is not written over while it is flown
+    uint8_t trajectory_id = 1 + a.slot;
+    uint32_t piece_offset = a.slot * trajectory_pieces;
+    a.slot ^= 1;
+
+    auto upload = std::make_shared<UploadTrajectory::Request>();
+    upload->trajectory_id = trajectory_id;
+    upload->piece_offset = piece_offset;
+    for (const polynomial_piece &piece : a.plan.pieces())
+    {
+        crazyflie_interfaces::msg::TrajectoryPolynomialPiece p;
+        p.poly_x.assign(piece.x, piece.x + polynomial_piece::coefficients);
+        p.poly_y.assign(piece.y, piece.y + polynomial_piece::coefficients);
+        p.poly_z.assign(piece.z, piece.z + polynomial_piece::coefficients);
+        p.poly_yaw.assign(piece.yaw, piece.yaw + polynomial_piece::coefficients);
+        p.duration.sec = std::floor(piece.duration);
+        p.duration.nanosec = (piece.duration - std::floor(piece.duration)) * 1e9;
+        upload->pieces.push_back(p);
+    }
+
+    // nothing to fly, the agent holds where it is
+    if (upload->pieces.empty() && !release)
+        return true;
+
+    auto start = std::make_shared<StartTrajectory::Request>();
+    start->group_mask = 0;
+    start->trajectory_id = trajectory_id;
+    start->timescale = 1.0;
+    start->reversed = false;
+    start->relative = false;
+
+    // already on the targets, the high level commander is given the
+    // position to hold once the stream ends
+    std::shared_ptr<GoTo::Request> hold;
+    if (upload->pieces.empty())
+    {
+        hold = std::make_shared<GoTo::Request>();
+        hold->group_mask = 0;
+        hold->relative = false;
+        hold->goal.x = swarm.position[index].x();
+        hold->goal.y = swarm.position[index].y();
+        hold->goal.z = swarm.position[index].z();
+        hold->yaw = 0.0;
+        hold->duration.sec = 1;
+    }
+
+    // each request waits for the one before, the firmware ignores the
+    // trajectory until the stream is stopped
+    auto start_client = comm.start_trajectory;
+    auto upload_client = comm.upload_trajectory;
+    auto go_to_client = comm.go_to;
+    auto send_upload = [upload_client, upload, start_client, start, go_to_client, hold]()
+    {
+        if (hold)
+        {
+            go_to_client->async_send_request(hold);
+            return;
+        }
+        upload_client->async_send_request(upload,
+            [start_client, start](rclcpp::Client<UploadTrajectory>::SharedFuture)
+            {
+                start_client->async_send_request(start);
+            });
+    };
+
+    if (!release)
+    {
+        send_upload();
+        return true;
+    }
+
+    auto stop = std::make_shared<NotifySetpointsStop::Request>();
+    stop->group_mask = 0;
+    stop->remain_valid_millisecs = 100;
+    comm.notify_setpoints_stop->async_send_request(stop,
+        [send_upload](rclcpp::Client<NotifySetpointsStop>::SharedFuture)
+        {
+            send_upload();
+        });
+    return true;
+}
+
+void cs2::cs2_application::leave_trajectory(size_t index)
+{
+    agent_trajectory &a = agents_trajectory[index];
+
+    // the high level commands are ignored while the stream is on
+    if (a.streaming)
+    {
+        auto stop = std::make_shared<NotifySetpointsStop::Request>();
+        stop->group_mask = 0;
+        stop->remain_valid_millisecs = 100;
+        agents_comm[index].notify_setpoints_stop->async_send_request(stop);
+    }
+
+    a.active = false;
+    a.streaming = false;
+    velocity_scheduler->reset(index);
+}
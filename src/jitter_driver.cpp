@@ -0,0 +1,334 @@
+/*
+* jitter_driver.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/twist.hpp"
+
+#include "apriltag_msgs/msg/april_tag_detection_array.hpp"
+#include "apriltag_msgs/msg/april_tag_detection.hpp"
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+#include "common.h"
+
+#include <Eigen/Dense>
+
+using geometry_msgs::msg::PoseStamped;
+using geometry_msgs::msg::Twist;
+using apriltag_msgs::msg::AprilTagDetection;
+using apriltag_msgs::msg::AprilTagDetectionArray;
+using diagnostic_msgs::msg::DiagnosticArray;
+
+using namespace std::chrono_literals;
+
+using namespace common;
+
+using std::placeholders::_1;
+
+/**
+ * @brief drives a running cs2_application to measure its planning tick
+ * jitter under tag bursts. It streams the poses of every agent, then after
+ * a quiet phase sends bursts of relocalization tags to a few agents at a
+ * time, and reads the planning jitter the node itself records from
+ * /diagnostics. The node runs with its own executors and callback groups,
+ * so what is measured is the layout that flies. Prints one line per phase
+ * and shuts down, see launch/jitter.py.
+**/
+class jitter_driver : public rclcpp::Node
+{
+    private:
+        struct agent
+        {
+            std::string name;
+            Eigen::Vector3d position;
+            rclcpp::Publisher<PoseStamped>::SharedPtr pose_publisher;
+            rclcpp::Publisher<Twist>::SharedPtr vel_publisher;
+            rclcpp::Publisher<AprilTagDetectionArray>::SharedPtr tag_publisher;
+        };
+
+        enum phase
+        {
+            WARM_UP,
+            QUIET,
+            BURSTS,
+            DONE
+        };
+
+        // the per period percentiles of /diagnostics within one phase
+        struct phase_summary
+        {
+            size_t periods = 0;
+            uint64_t ticks = 0;
+            std::vector<double> p50;
+            double p99 = 0.0;
+            double max = 0.0;
+            uint64_t solves = 0;
+            double solve_p99 = 0.0;
+        };
+
+        rclcpp::Clock clock;
+        std::chrono::steady_clock::time_point start;
+
+        std::vector<agent> agents;
+        std::vector<int> relocalization_tags;
+
+        rclcpp::TimerBase::SharedPtr pose_timer;
+        rclcpp::TimerBase::SharedPtr tag_timer;
+        rclcpp::Subscription<DiagnosticArray>::SharedPtr diagnostics_sub;
+
+        size_t burst_agents;
+        double burst_period;
+        double burst_length;
+        double phase_duration;
+        double warm_up;
+
+        phase_summary summaries[2];
+
+        double elapsed() const
+        {
+            return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        phase current_phase() const
+        {
+            double t = elapsed();
+            if (t < warm_up)
+                return WARM_UP;
+            if (t < warm_up + phase_duration)
+                return QUIET;
+            if (t < warm_up + 2.0 * phase_duration)
+                return BURSTS;
+            return DONE;
+        }
+
+        static double value_of(const diagnostic_msgs::msg::DiagnosticStatus &status, 
+            const std::string &key)
+        {
+            for (const auto &kv : status.values)
+                if (kv.key == key)
+                    return std::stod(kv.value);
+            return 0.0;
+        }
+
+        static bool ends_with(const std::string &name, const std::string &suffix)
+        {
+            return name.size() >= suffix.size() && 
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+
+    public:
+
+        explicit jitter_driver(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("jitter_driver", options), clock(RCL_ROS_TIME)
+        {
+            this->declare_parameter("jitter.burst_agents", 4);
+            this->declare_parameter("jitter.burst_period", 2.0);
+            this->declare_parameter("jitter.burst_length", 0.6);
+            this->declare_parameter("jitter.phase_duration", 20.0);
+            this->declare_parameter("jitter.warm_up", 3.0);
+
+            burst_agents = (size_t)std::max(
+                this->get_parameter("jitter.burst_agents").get_parameter_value().get<int>(), 1);
+            burst_period = 
+                this->get_parameter("jitter.burst_period").get_parameter_value().get<double>();
+            burst_length = 
+                this->get_parameter("jitter.burst_length").get_parameter_value().get<double>();
+            phase_duration = 
+                this->get_parameter("jitter.phase_duration").get_parameter_value().get<double>();
+            warm_up = 
+                this->get_parameter("jitter.warm_up").get_parameter_value().get<double>();
+
+            // the same crazyflies and tags as the application
+            auto node_parameters_iface = this->get_node_parameters_interface();
+            const std::map<std::string, rclcpp::ParameterValue> &parameter_overrides =
+                node_parameters_iface->get_parameter_overrides();
+
+            auto cf_names = extract_names(parameter_overrides, "robots");
+            for (const auto &name : cf_names) 
+            {
+                std::vector<double> pos = parameter_overrides.at(
+                    "robots." + name + ".initial_position").get<std::vector<double>>();
+
+                agent a;
+                a.name = name;
+                // hovering, so that every planning tick has the swarm to plan
+                a.position = Eigen::Vector3d(pos[0], pos[1], 1.0);
+                a.pose_publisher = this->create_publisher<PoseStamped>(name + "/pose", 7);
+                a.vel_publisher = this->create_publisher<Twist>(name + "/vel", 7);
+                a.tag_publisher = 
+                    this->create_publisher<AprilTagDetectionArray>(name + "/tag", 7);
+                agents.push_back(a);
+            }
+
+            auto april_names = extract_names(parameter_overrides, "april_tags.tags");
+            for (const auto &name : april_names) 
+            {
+                std::string purpose = parameter_overrides.at(
+                    "april_tags.tags." + name + ".purpose").get<std::string>();
+                if (strcmp(purpose.c_str(), relocalize.c_str()) != 0)
+                    continue;
+
+                // idXXX or a pair idXXX idXXX, as the application reads them
+                for (std::string id : split_space_delimiter(name))
+                    relocalization_tags.push_back(std::stoi(id.erase(0, 2)));
+            }
+
+            if (agents.empty() || relocalization_tags.empty())
+                RCLCPP_ERROR(this->get_logger(), 
+                    "%zu agents and %zu relocalization tags, the bursts need both", 
+                    agents.size(), relocalization_tags.size());
+
+            start = std::chrono::steady_clock::now();
+
+            pose_timer = this->create_wall_timer(
+                10ms, std::bind(&jitter_driver::pose_timer_callback, this));
+            tag_timer = this->create_wall_timer(
+                50ms, std::bind(&jitter_driver::tag_timer_callback, this));
+            diagnostics_sub = this->create_subscription<DiagnosticArray>(
+                "/diagnostics", 10, std::bind(&jitter_driver::diagnostics_callback, this, _1));
+
+            RCLCPP_INFO(this->get_logger(), 
+                "%zu agents, %.1lfs quiet then %.1lfs of bursts to %zu agents every %.1lfs", 
+                agents.size(), phase_duration, phase_duration, burst_agents, burst_period);
+        }
+
+        void pose_timer_callback()
+        {
+            auto stamp = clock.now();
+            for (const agent &a : agents)
+            {
+                PoseStamped pose;
+                pose.header.stamp = stamp;
+                pose.header.frame_id = "world";
+                pose.pose.position.x = a.position.x();
+                pose.pose.position.y = a.position.y();
+                pose.pose.position.z = a.position.z();
+                pose.pose.orientation.w = 1.0;
+                a.pose_publisher->publish(pose);
+
+                a.vel_publisher->publish(Twist());
+            }
+        }
+
+        void tag_timer_callback()
+        {
+            if (current_phase() != BURSTS || agents.empty() || relocalization_tags.empty())
+                return;
+
+            // the first burst_length of every burst_period, each burst to
+            // the next agents so that every smoother gets its turn
+            double t = elapsed() - warm_up - phase_duration;
+            size_t burst = (size_t)(t / burst_period);
+            if (t - (double)burst * burst_period > burst_length)
+                return;
+
+            auto stamp = clock.now();
+            for (size_t k = 0; k < std::min(burst_agents, agents.size()); k++)
+            {
+                const agent &a = agents[(burst * burst_agents + k) % agents.size()];
+
+                AprilTagDetectionArray detections;
+                detections.header.stamp = stamp;
+                for (int id : relocalization_tags)
+                {
+                    AprilTagDetection detection;
+                    detection.family = "36h11";
+                    detection.id = id;
+                    detection.centre.x = 320.0;
+                    detection.centre.y = 240.0;
+                    // a metre in front of the camera
+                    detection.pose.pose.position.z = 1.0;
+                    detection.pose.pose.orientation.w = 1.0;
+                    detections.detections.push_back(detection);
+                }
+                a.tag_publisher->publish(detections);
+            }
+        }
+
+        void diagnostics_callback(const DiagnosticArray &msg)
+        {
+            phase p = current_phase();
+            if (p == WARM_UP)
+                return;
+            if (p == DONE)
+            {
+                print_summary();
+                rclcpp::shutdown();
+                return;
+            }
+
+            phase_summary &s = summaries[p == QUIET ? 0 : 1];
+            for (const auto &status : msg.status)
+            {
+                if (ends_with(status.name, ": planning jitter"))
+                {
+                    s.periods++;
+                    s.ticks += (uint64_t)value_of(status, "count");
+                    s.p50.push_back(value_of(status, "p50_ms"));
+                    s.p99 = std::max(s.p99, value_of(status, "p99_ms"));
+                    s.max = std::max(s.max, value_of(status, "max_ms"));
+                }
+                else if (ends_with(status.name, ": relocalization solve"))
+                {
+                    s.solves += (uint64_t)value_of(status, "count");
+                    s.solve_p99 = std::max(s.solve_p99, value_of(status, "p99_ms"));
+                }
+            }
+        }
+
+        void print_summary()
+        {
+            printf("%-7s %8s %6s %9s %9s %9s %7s %14s\n", "phase", "periods", "ticks", 
+                "p50(ms)", "p99(ms)", "max(ms)", "solves", "solve_p99(ms)");
+
+            const char *names[2] = {"quiet", "bursts"};
+            for (size_t i = 0; i < 2; i++)
+            {
+                phase_summary &s = summaries[i];
+                // median over the periods, the worst period for the tails
+                double p50 = 0.0;
+                if (!s.p50.empty())
+                {
+                    std::sort(s.p50.begin(), s.p50.end());
+                    p50 = s.p50[s.p50.size() / 2];
+                }
+                printf("%-7s %8zu %6lu %9.3f %9.3f %9.3f %7lu %14.3f\n", names[i], 
+                    s.periods, s.ticks, p50, s.p99, s.max, s.solves, s.solve_p99);
+            }
+            fflush(stdout);
+        }
+};
+
+int main(int argc, char *argv[])
+{
+    rclcpp::init(argc, argv);
+    rclcpp::spin(std::make_shared<jitter_driver>());
+    rclcpp::shutdown();
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+* job_queue.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "job_queue.h"
+
+#include <algorithm>
+
+common::job_queue::job_queue(size_t thread_count)
+{
+    for (size_t i = 0; i < std::max(thread_count, (size_t)1); i++)
+        workers.emplace_back(&job_queue::worker_loop, this);
+}
+
+common::job_queue::~job_queue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        jobs.clear();
+    }
+    cv.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void common::job_queue::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+size_t common::job_queue::depth() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + running;
+}
+
+void common::job_queue::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        cv.wait(lock, [this] { return stop || !jobs.empty(); });
+        if (stop)
+            return;
+
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        running++;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        running--;
+    }
+}
@@ -0,0 +1,39 @@
+/*
+* landmark_table.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "landmark_table.h"
+
+bool common::landmark_table::add(int id, const Eigen::Affine3d &world_to_tag,
+    const gtsam::SharedNoiseModel &prior_noise)
+{
+    if (id < 0 || id > max_id || find(id) != nullptr)
+        return false;
+
+    if ((size_t)id >= slots.size())
+        slots.resize(id + 1, -1);
+    slots[id] = (int32_t)entries.size();
+
+    landmark l;
+    l.id = id;
+    l.world_to_tag = world_to_tag;
+    l.prior = gtsam::Pose3(world_to_tag.matrix());
+    l.prior_noise = prior_noise;
+    entries.push_back(l);
+
+    return true;
+}
@@ -0,0 +1,96 @@
+/*
+* latency_histogram.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+
+common::latency_histogram::latency_histogram()
+{
+    for (auto &b : buckets)
+        b.store(0, std::memory_order_relaxed);
+}
+
+size_t common::latency_histogram::bucket_of(uint64_t value)
+{
+    if (value < sub_buckets)
+        return (size_t)value;
+
+    // position of the highest bit, the two below it pick the sub bucket
+    size_t exponent = 63 - (size_t)__builtin_clzll(value);
+    if (exponent >= max_exponent)
+        return bucket_count - 1;
+
+    size_t sub = (size_t)(value >> (exponent - 2)) & (sub_buckets - 1);
+    return sub_buckets + (exponent - 2) * sub_buckets + sub;
+}
+
+uint64_t common::latency_histogram::upper_bound(size_t bucket)
+{
+    if (bucket < sub_buckets)
+        return bucket + 1;
+
+    size_t exponent = (bucket - sub_buckets) / sub_buckets + 2;
+    size_t sub = (bucket - sub_buckets) % sub_buckets;
+    return (uint64_t)(sub_buckets + sub + 1) << (exponent - 2);
+}
+
+void common::latency_histogram::record(int64_t nanoseconds)
+{
+    uint64_t value = (uint64_t)std::max(nanoseconds, (int64_t)0);
+    buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t current = max_value.load(std::memory_order_relaxed);
+    while (value > current && 
+        !max_value.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+common::latency_histogram::summary common::latency_histogram::collect()
+{
+    uint64_t counts[bucket_count];
+    summary s = {};
+    for (size_t b = 0; b < bucket_count; b++)
+    {
+        counts[b] = buckets[b].exchange(0, std::memory_order_relaxed);
+        s.count += counts[b];
+    }
+    uint64_t max_ns = max_value.exchange(0, std::memory_order_relaxed);
+
+    if (s.count == 0)
+        return s;
+
+    s.max = (double)max_ns * 1e-6;
+
+    // the first bucket where the running count reaches the rank
+    const double quantiles[3] = {0.50, 0.90, 0.99};
+    double *results[3] = {&s.p50, &s.p90, &s.p99};
+    size_t q = 0;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < bucket_count && q < 3; b++)
+    {
+        seen += counts[b];
+        while (q < 3 && (double)seen >= quantiles[q] * (double)s.count)
+        {
+            // a bucket bound past the largest value is the largest value
+            *results[q] = std::min((double)upper_bound(b) * 1e-6, s.max);
+            q++;
+        }
+    }
+
+    return s;
+}
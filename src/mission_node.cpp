@@ -31,6 +31,7 @@
 #include "crazyswarm_application/msg/agent_state.hpp"
 
 #include <rclcpp/rclcpp.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 #include "common.h"
 
 using crazyswarm_application::msg::UserCommand;
@@ -78,6 +79,9 @@ class mission_handler : public rclcpp::Node
 
         rclcpp::Subscription<UserCommand>::SharedPtr external_command_subscription;
 
+        // false when other nodes share the process, see the composed launch
+        bool shutdown_on_completion;
+
         std::map<std::string, agent_state> agents_description;
 
         std::queue<commander> external_command_queue;
@@ -91,11 +95,15 @@ class mission_handler : public rclcpp::Node
         // uint8 HOVER = 4 # Stop and hover
         // uint8 LAND = 5 # Landing sequence
 
-        mission_handler()
-            : Node("mission_handler"), clock(RCL_ROS_TIME)
+        explicit mission_handler(
+            const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+            : Node("mission_handler", options), clock(RCL_ROS_TIME)
         {
             RCLCPP_INFO(this->get_logger(), "start constructor");
 
+            shutdown_on_completion = 
+                this->declare_parameter("shutdown_on_completion", true);
+
             last_mission_time = clock.now();
 
             this->declare_parameter("command_sequence");
@@ -198,28 +206,27 @@ class mission_handler : public rclcpp::Node
             RCLCPP_INFO(this->get_logger(), "end_constructor");
         }
 
-        void external_command_callback(const UserCommand::SharedPtr msg)
+        void external_command_callback(const UserCommand &msg)
         {
             commander ext;
             ext.task = "goto_velocity";
 
-            for (std::string agent : msg->uav_id)
+            for (const std::string &agent : msg.uav_id)
                 ext.agents.push_back(agent);
             
             ext.target = Eigen::Vector4d(
-                msg->goal.x, msg->goal.y, msg->goal.z, msg->yaw
+                msg.goal.x, msg.goal.y, msg.goal.z, msg.yaw
             );
 
             external_command_queue.push(ext);
         }
 
-        void agent_event_callback(const AgentsStateFeedback::SharedPtr msg)
+        void agent_event_callback(const AgentsStateFeedback &msg)
         {            
             rclcpp::Time now = clock.now();
 
-            AgentsStateFeedback copy = *msg;
             // copy agent messages into local states
-            for (auto &agent : copy.agents)
+            for (const auto &agent : msg.agents)
             {
                 // check agents_description queue
                 std::map<std::string, agent_state>::iterator it = 
@@ -327,7 +334,14 @@ class mission_handler : public rclcpp::Node
                 // close the mission node when we have finished
                 RCLCPP_INFO(this->get_logger(), "It's been a long day without you, my friend");
                 RCLCPP_INFO(this->get_logger(), "And I'll tell you all about it when I see you again");
-                rclcpp::shutdown();
+                // in a component container the other nodes keep running
+                if (shutdown_on_completion)
+                    rclcpp::shutdown();
+                else
+                {
+                    agent_state_subscription.reset();
+                    external_command_subscription.reset();
+                }
                 return;
             }
 
@@ -347,9 +361,9 @@ class mission_handler : public rclcpp::Node
                     // "all"
                     if (strcmp(cmd->agents[0].c_str(), dict.all.c_str()) == 0)
                     {
-                        UserCommand command;
-                        command.cmd = "takeoff_all";
-                        command_publisher->publish(command);
+                        auto command = std::make_unique<UserCommand>();
+                        command->cmd = "takeoff_all";
+                        command_publisher->publish(std::move(command));
 
                         cmd->sent_mission = true;
 
@@ -359,8 +373,8 @@ class mission_handler : public rclcpp::Node
                     }
 
                     // individual
-                    UserCommand command;
-                    command.cmd = "takeoff";
+                    auto command = std::make_unique<UserCommand>();
+                    command->cmd = "takeoff";
                     std::string acc_id;
                     for (auto &agent : cmd->agents)
                     {
@@ -370,11 +384,11 @@ class mission_handler : public rclcpp::Node
                         if (it == agents_description.end())
                             continue;
                         
-                        command.uav_id.push_back(it->first);
+                        command->uav_id.push_back(it->first);
                         acc_id += it->first;
                     }
                     
-                    command_publisher->publish(command);
+                    command_publisher->publish(std::move(command));
                     cmd->sent_mission = true;
 
                     RCLCPP_INFO(this->get_logger(), "Sent %s takeoff", acc_id.c_str());
@@ -384,15 +398,15 @@ class mission_handler : public rclcpp::Node
                 else if(strcmp(cmd->task.c_str(), 
                     dict.go_to_velocity.c_str()) == 0)
                 {
-                    UserCommand command;
-                    command.cmd = "goto_velocity";
+                    auto command = std::make_unique<UserCommand>();
+                    command->cmd = "goto_velocity";
                     std::string acc_id;
 
                     // "all"
                     if (strcmp(cmd->agents[0].c_str(), dict.all.c_str()) == 0) 
                         for (auto &[key, state] : agents_description)
                         {
-                            command.uav_id.push_back(key);
+                            command->uav_id.push_back(key);
                             acc_id += key;
                         }
                     // "individual"
@@ -406,17 +420,17 @@ class mission_handler : public rclcpp::Node
                             if (it == agents_description.end())
                                 continue;
                             
-                            command.uav_id.push_back(it->first);
+                            command->uav_id.push_back(it->first);
                             acc_id += it->first;
                         }
                     }
                         
-                    command.goal.x = cmd->target[0];
-                    command.goal.y = cmd->target[1];
-                    command.goal.z = cmd->target[2];
-                    command.yaw = cmd->target[3];
+                    command->goal.x = cmd->target[0];
+                    command->goal.y = cmd->target[1];
+                    command->goal.z = cmd->target[2];
+                    command->yaw = cmd->target[3];
                     
-                    command_publisher->publish(command);
+                    command_publisher->publish(std::move(command));
                     cmd->sent_mission = true;
                     
                     RCLCPP_INFO(this->get_logger(), "Sent %s goto_velocity", 
@@ -426,15 +440,15 @@ class mission_handler : public rclcpp::Node
                 // "goto"
                 else if(strcmp(cmd->task.c_str(), dict.go_to.c_str()) == 0)
                 {
-                    UserCommand command;
-                    command.cmd = "goto";
+                    auto command = std::make_unique<UserCommand>();
+                    command->cmd = "goto";
                     std::string acc_id;
 
                     // "all"
                     if (strcmp(cmd->agents[0].c_str(), dict.all.c_str()) == 0) 
                         for (auto &[key, state] : agents_description)
                         {
-                            command.uav_id.push_back(key);
+                            command->uav_id.push_back(key);
                             acc_id += key;
                         }
                     // "individual"
@@ -448,17 +462,17 @@ class mission_handler : public rclcpp::Node
                             if (it == agents_description.end())
                                 continue;
                             
-                            command.uav_id.push_back(it->first);
+                            command->uav_id.push_back(it->first);
                             acc_id += it->first;
                         }
                     }
                         
-                    command.goal.x = cmd->target[0];
-                    command.goal.y = cmd->target[1];
-                    command.goal.z = cmd->target[2];
-                    command.yaw = cmd->target[3];
+                    command->goal.x = cmd->target[0];
+                    command->goal.y = cmd->target[1];
+                    command->goal.z = cmd->target[2];
+                    command->yaw = cmd->target[3];
                     
-                    command_publisher->publish(command);
+                    command_publisher->publish(std::move(command));
                     cmd->sent_mission = true;
                     
                     RCLCPP_INFO(this->get_logger(), "Sent %s goto", 
@@ -471,9 +485,9 @@ class mission_handler : public rclcpp::Node
                     // "all"
                     if (strcmp(cmd->agents[0].c_str(), dict.all.c_str()) == 0)
                     {
-                        UserCommand command;
-                        command.cmd = "land_all";
-                        command_publisher->publish(command);
+                        auto command = std::make_unique<UserCommand>();
+                        command->cmd = "land_all";
+                        command_publisher->publish(std::move(command));
                         cmd->sent_mission = true;
 
                         RCLCPP_INFO(this->get_logger(), "Sent %s land", 
@@ -482,8 +496,8 @@ class mission_handler : public rclcpp::Node
                     }
 
                     // individual
-                    UserCommand command;
-                    command.cmd = "land";
+                    auto command = std::make_unique<UserCommand>();
+                    command->cmd = "land";
                     std::string acc_id;
                     for (auto &agent : cmd->agents)
                     {
@@ -493,11 +507,11 @@ class mission_handler : public rclcpp::Node
                         if (it == agents_description.end())
                             continue;
                         
-                        command.uav_id.push_back(it->first);
+                        command->uav_id.push_back(it->first);
                         acc_id += it->first;
                     }
 
-                    command_publisher->publish(command);
+                    command_publisher->publish(std::move(command));
                     cmd->sent_mission = true;
 
                     RCLCPP_INFO(this->get_logger(), "Sent %s land", acc_id.c_str());
@@ -508,8 +522,8 @@ class mission_handler : public rclcpp::Node
                 {
                     while (!external_command_queue.empty())
                     {
-                        UserCommand command;
-                        command.cmd = external_command_queue.front().task;
+                        auto command = std::make_unique<UserCommand>();
+                        command->cmd = external_command_queue.front().task;
                         std::string acc_id;
                         // "individual"
                         for (auto &agent : external_command_queue.front().agents)
@@ -520,17 +534,17 @@ class mission_handler : public rclcpp::Node
                             if (it == agents_description.end())
                                 continue;
                             
-                            command.uav_id.push_back(it->first);
+                            command->uav_id.push_back(it->first);
                             acc_id += it->first;
                         }
                             
-                        command.goal.x = external_command_queue.front().target[0];
-                        command.goal.y = external_command_queue.front().target[1];
-                        command.goal.z = external_command_queue.front().target[2];
-                        command.yaw = external_command_queue.front().target[3];
-                        command.is_external = true;
+                        command->goal.x = external_command_queue.front().target[0];
+                        command->goal.y = external_command_queue.front().target[1];
+                        command->goal.z = external_command_queue.front().target[2];
+                        command->yaw = external_command_queue.front().target[3];
+                        command->is_external = true;
                         
-                        command_publisher->publish(command);
+                        command_publisher->publish(std::move(command));
                         // cmd->sent_mission = true;
                         
                         RCLCPP_INFO(this->get_logger(), "Sent %s external", 
@@ -612,17 +626,4 @@ class mission_handler : public rclcpp::Node
 
 };
 
-int main(int argc, char *argv[])
-{
-    rclcpp::init(argc, argv);
-
-    size_t thread_count = 1;
-    rclcpp::executors::MultiThreadedExecutor 
-        executor(rclcpp::ExecutorOptions(), thread_count, false);
-    auto node = std::make_shared<mission_handler>();
-    executor.add_node(node);
-    executor.spin();
-    rclcpp::shutdown();
-    
-    return 0;
-}
\ No newline at end of file
+RCLCPP_COMPONENTS_REGISTER_NODE(mission_handler)
@@ -0,0 +1,81 @@
+/*
+* obstacle_grid.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "obstacle_grid.h"
+
+#include <algorithm>
+
+void common::obstacle_grid::build(
+    const std::vector<std::pair<Eigen::Vector2f, Eigen::Vector2f>> &segments,
+    float range)
+{
+    cell_start.clear();
+    entries.clear();
+    if (segments.empty() || range <= 0.0f)
+        return;
+
+    cell_size = range;
+
+    // bounding box of all the segments grown by the range
+    Eigen::Vector2f lo = segments.front().first;
+    Eigen::Vector2f hi = lo;
+    for (const auto &s : segments)
+    {
+        lo = lo.cwiseMin(s.first).cwiseMin(s.second);
+        hi = hi.cwiseMax(s.first).cwiseMax(s.second);
+    }
+    origin = lo - Eigen::Vector2f::Constant(range);
+    columns = (int)std::floor((hi.x() + range - origin.x()) / cell_size) + 1;
+    rows = (int)std::floor((hi.y() + range - origin.y()) / cell_size) + 1;
+
+    // cells overlapped by the bounding box of a segment grown by the range
+    auto cells_of = [&](const std::pair<Eigen::Vector2f, Eigen::Vector2f> &s,
+        int *min_cell, int *max_cell)
+    {
+        Eigen::Vector2f s_lo = s.first.cwiseMin(s.second) - origin;
+        Eigen::Vector2f s_hi = s.first.cwiseMax(s.second) - origin;
+        min_cell[0] = std::max(0, (int)std::floor((s_lo.x() - range) / cell_size));
+        min_cell[1] = std::max(0, (int)std::floor((s_lo.y() - range) / cell_size));
+        max_cell[0] = std::min(columns - 1, (int)std::floor((s_hi.x() + range) / cell_size));
+        max_cell[1] = std::min(rows - 1, (int)std::floor((s_hi.y() + range) / cell_size));
+    };
+
+    // count then fill, same layout as the spatial grid buckets
+    cell_start.assign((size_t)columns * (size_t)rows + 1, 0);
+    int min_cell[2], max_cell[2];
+    for (const auto &s : segments)
+    {
+        cells_of(s, min_cell, max_cell);
+        for (int y = min_cell[1]; y <= max_cell[1]; y++)
+            for (int x = min_cell[0]; x <= max_cell[0]; x++)
+                cell_start[(size_t)y * (size_t)columns + (size_t)x + 1]++;
+    }
+
+    for (size_t c = 1; c < cell_start.size(); c++)
+        cell_start[c] += cell_start[c-1];
+
+    entries.resize(cell_start.back());
+    std::vector<uint32_t> cursor(cell_start.begin(), cell_start.end() - 1);
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        cells_of(segments[i], min_cell, max_cell);
+        for (int y = min_cell[1]; y <= max_cell[1]; y++)
+            for (int x = min_cell[0]; x <= max_cell[0]; x++)
+                entries[cursor[(size_t)y * (size_t)columns + (size_t)x]++] = (uint32_t)i;
+    }
+}
@@ -255,23 +255,26 @@ namespace RVO
   /**
    * @brief      Solves a four-dimensional linear program subject to linear
    *             constraints defined by planes and a spherical constraint.
-   * @param[in]  planes     Planes defining the linear constraints.
-   * @param[in]  beginPlane The plane on which the three-dimensional linear
-   *                        program failed.
-   * @param[in]  radius     The radius of the spherical constraint.
-   * @param[out] result     A reference to the result of the linear program.
+   * @param[in]  planes        Planes defining the linear constraints.
+   * @param[in]  numObstPlanes Count of obstacle planes, these come first and
+   *                           are kept as hard constraints.
+   * @param[in]  beginPlane    The plane on which the three-dimensional linear
+   *                           program failed.
+   * @param[in]  radius        The radius of the spherical constraint.
+   * @param[out] result        A reference to the result of the linear program.
    */
-  void Agent::linearProgram4(const std::vector<Plane> &planes, std::size_t beginPlane,
-                      float radius,
+  void Agent::linearProgram4(const std::vector<Plane> &planes, std::size_t numObstPlanes,
+                      std::size_t beginPlane, float radius,
                       Eigen::Vector3f &result) { /* NOLINT(runtime/references) */
     float distance = 0.0F;
 
     for (std::size_t i = beginPlane; i < planes.size(); ++i) {
       if (planes[i].normal.dot(planes[i].point - result) > distance) {
         /* Result does not satisfy constraint of plane i. */
-        std::vector<Plane> projPlanes;
+        std::vector<Plane> &projPlanes = projPlanes_;
+        projPlanes.assign(planes.begin(), planes.begin() + numObstPlanes);
 
-        for (std::size_t j = 0U; j < i; ++j) {
+        for (std::size_t j = numObstPlanes; j < i; ++j) {
           Plane plane;
 
           const Eigen::Vector3f crossProduct = planes[j].normal.cross(planes[i].normal);
@@ -318,82 +321,96 @@ namespace RVO
   }
 
   void Agent::computeNewVelocity() {
-    orcaPlanes_.clear();
+    /* Create obstacle ORCA planes. The velocity towards the closest point
+     * is limited so that the gap closes no sooner than the time horizon.
+     */
     const float invTimeHorizon = 1.0F / timeHorizon_;
+    const float invTimeStep = 1.0F / timeStep_;
+    orcaPlanes_.clear();
 
-    /* Create agent ORCA planes. */
-    for (std::size_t i = 0U; i < agentNeighbors_.size(); ++i) {
-      const Eval_agent other = agentNeighbors_[i].second;
-      const Eigen::Vector3f relativePosition = other.position_ - position_;
-      const Eigen::Vector3f relativeVelocity = velocity_ - other.velocity_;
-      const float distSq = relativePosition.dot(relativePosition);
-      const float combinedRadius = radius_ + other.radius_;
-      const float combinedRadiusSq = combinedRadius * combinedRadius;
+    for (std::size_t i = 0U; i < obstacleNeighbors_.size(); ++i) {
+      const Eigen::Vector3f relativePosition =
+          obstacleNeighbors_[i].second - position_;
+      const float dist = std::sqrt(obstacleNeighbors_[i].first);
 
-      Plane plane;
-      Eigen::Vector3f u;
-
-      if (distSq > combinedRadiusSq) {
-        /* No collision. */
-        const Eigen::Vector3f w = relativeVelocity - invTimeHorizon * relativePosition;
-        /* Vector from cutoff center to relative velocity. */
-        const float wLengthSq = w.dot(w);
-
-        const float dotProduct = w.dot(relativePosition);
-
-        if (dotProduct < 0.0F &&
-            dotProduct * dotProduct > combinedRadiusSq * wLengthSq) {
-          /* Project on cut-off circle. */
-          const float wLength = std::sqrt(wLengthSq);
-          const Eigen::Vector3f unitW = w / wLength;
-
-          plane.normal = unitW;
-          u = (combinedRadius * invTimeHorizon - wLength) * unitW;
-        } else {
-          /* Project on cone. */
-          const float a = distSq;
-          const float b = relativePosition.dot(relativeVelocity);
-          const float c = std::pow((relativeVelocity).norm(),2) -
-                          std::pow((relativePosition.cross(relativeVelocity)).norm(),2) /
-                              (distSq - combinedRadiusSq);
-          const float t = (b + std::sqrt(b * b - a * c)) / a;
-          const Eigen::Vector3f ww = relativeVelocity - t * relativePosition;
-          const float wwLength = ww.norm();
-          const Eigen::Vector3f unitWW = ww / wwLength;
-
-          plane.normal = unitWW;
-          u = (combinedRadius * t - wwLength) * unitWW;
-        }
-      } else {
-        /* Collision. */
-        const float invTimeStep = 1.0F / timeStep_;
-        const Eigen::Vector3f w = relativeVelocity - invTimeStep * relativePosition;
-        const float wLength = w.norm();
-        const Eigen::Vector3f unitW = w / wLength;
-
-        plane.normal = unitW;
-        u = (combinedRadius * invTimeStep - wLength) * unitW;
+      if (dist <= RVO3D_EPSILON) {
+        /* On the wall, there is no direction to push away in. */
+        continue;
       }
 
-      plane.point = velocity_ + 0.5F * u;
+      const Eigen::Vector3f unitRelativePosition = relativePosition / dist;
+      /* Collision uses the time step, as for the agents. */
+      const float invTime = dist > radius_ ? invTimeHorizon : invTimeStep;
+
+      Plane plane;
+      plane.normal = -unitRelativePosition;
+      plane.point = (dist - radius_) * invTime * unitRelativePosition;
       orcaPlanes_.push_back(plane);
     }
 
+    const std::size_t numObstPlanes = orcaPlanes_.size();
+
+    /* Pack the neighbours so that their planes are built several at a time. */
+    neighborBuffer_.resize(agentNeighbors_.size());
+
+    for (std::size_t i = 0U; i < agentNeighbors_.size(); ++i) {
+      const Eval_agent &other = agentNeighbors_[i].second;
+      neighborBuffer_.px[i] = other.position_.x();
+      neighborBuffer_.py[i] = other.position_.y();
+      neighborBuffer_.pz[i] = other.position_.z();
+      neighborBuffer_.vx[i] = other.velocity_.x();
+      neighborBuffer_.vy[i] = other.velocity_.y();
+      neighborBuffer_.vz[i] = other.velocity_.z();
+      neighborBuffer_.radius[i] = other.radius_;
+    }
+
+    /* Create agent ORCA planes. */
+    buildOrcaPlanes(neighborBuffer_, position_, velocity_, radius_,
+                    timeHorizon_, timeStep_, planeBuffer_);
+
+    orcaPlanes_.resize(numObstPlanes + agentNeighbors_.size());
+
+    for (std::size_t i = 0U; i < agentNeighbors_.size(); ++i) {
+      Plane &plane = orcaPlanes_[numObstPlanes + i];
+      plane.normal = Eigen::Vector3f(
+          planeBuffer_.nx[i], planeBuffer_.ny[i], planeBuffer_.nz[i]);
+      plane.point = Eigen::Vector3f(
+          planeBuffer_.px[i], planeBuffer_.py[i], planeBuffer_.pz[i]);
+    }
+
     const std::size_t planeFail = linearProgram3(
         orcaPlanes_, maxSpeed_, prefVelocity_, false, newVelocity_);
 
     if (planeFail < orcaPlanes_.size()) {
-      linearProgram4(orcaPlanes_, planeFail, maxSpeed_, newVelocity_);
+      linearProgram4(orcaPlanes_, numObstPlanes, planeFail, maxSpeed_,
+                     newVelocity_);
     }
   }
 
-  void Agent::insertAgentNeighbor(const Eval_agent agent, float &rangeSq) {
+  void Agent::insertAgentNeighbor(const Eval_agent &agent, float &rangeSq) {
+    const float distSq = (position_ - agent.position_).squaredNorm();
 
-    const float distSq = std::pow((position_ - agent.position_).norm(),2);
+    if (distSq < rangeSq) {
+      if (agentNeighbors_.size() < maxNeighbors_) {
+        agentNeighbors_.push_back(std::make_pair(distSq, agent));
+      }
+
+      /* Keep the list sorted by distance, the farthest neighbour drops off
+       * the end once it is full.
+       */
+      std::size_t i = agentNeighbors_.size() - 1U;
 
-    // communication radius is being handled by kdtree
-    agentNeighbors_.emplace_back(std::make_pair(distSq, agent));
+      while (i != 0U && distSq < agentNeighbors_[i - 1U].first) {
+        agentNeighbors_[i] = agentNeighbors_[i - 1U];
+        --i;
+      }
 
+      agentNeighbors_[i] = std::make_pair(distSq, agent);
+
+      if (agentNeighbors_.size() == maxNeighbors_) {
+        rangeSq = agentNeighbors_.back().first;
+      }
+    }
   }
 
   void Agent::clearAgentNeighbor() {
@@ -401,6 +418,50 @@ namespace RVO
     agentNeighbors_.clear();
   }
 
+  void Agent::insertObstacleNeighbor(const Eval_obstacle &obstacle,
+                                     float rangeSq) {
+    /* Closest point on the wall, along the segment and then in height. */
+    const Eigen::Vector2f segment = obstacle.end_ - obstacle.start_;
+    const float segmentLengthSq = segment.squaredNorm();
+    float s = 0.0F;
+
+    if (segmentLengthSq > RVO3D_EPSILON) {
+      s = (position_.head<2>() - obstacle.start_).dot(segment) / segmentLengthSq;
+      s = std::min(std::max(s, 0.0F), 1.0F);
+    }
+
+    const Eigen::Vector2f closestXY = obstacle.start_ + s * segment;
+    const Eigen::Vector3f closest(
+        closestXY.x(), closestXY.y(),
+        std::min(std::max(position_.z(), obstacle.minHeight_), obstacle.maxHeight_));
+    const float distSq = (position_ - closest).squaredNorm();
+
+    if (distSq < rangeSq) {
+      if (obstacleNeighbors_.size() < maxNeighbors_) {
+        obstacleNeighbors_.emplace_back(distSq, closest);
+      } else if (distSq >= obstacleNeighbors_.back().first) {
+        return;
+      }
+
+      /* Sorted as the agent neighbours, the farthest wall drops off the
+       * end once the reserved size is reached.
+       */
+      std::size_t i = obstacleNeighbors_.size() - 1U;
+
+      while (i != 0U && distSq < obstacleNeighbors_[i - 1U].first) {
+        obstacleNeighbors_[i] = obstacleNeighbors_[i - 1U];
+        --i;
+      }
+
+      obstacleNeighbors_[i] = std::make_pair(distSq, closest);
+    }
+  }
+
+  void Agent::clearObstacleNeighbor() {
+
+    obstacleNeighbors_.clear();
+  }
+
   void Agent::update() 
   {
     velocity_ = newVelocity_;
@@ -408,8 +469,8 @@ namespace RVO
   }
 
   void Agent::updateState(
-    Eigen::Vector3f pos, Eigen::Vector3f vel,
-    Eigen::Vector3f pref_vel) 
+    const Eigen::Vector3f &pos, const Eigen::Vector3f &vel,
+    const Eigen::Vector3f &pref_vel) 
   {
     position_ = pos;
     velocity_ = vel;
@@ -48,6 +48,8 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
+#include "orca_planes.h"
+
 namespace RVO 
 {
   /**
@@ -75,6 +77,18 @@ namespace RVO
     float radius_;
   };
 
+  /**
+   * @brief A static wall, the vertical rectangle above the segment from
+   *        start_ to end_ between minHeight_ and maxHeight_.
+   */
+  struct Eval_obstacle
+  {
+    Eigen::Vector2f start_;
+    Eigen::Vector2f end_;
+    float minHeight_;
+    float maxHeight_;
+  };
+
   /**
    * @brief Defines a directed line.
    */
@@ -98,8 +112,8 @@ namespace RVO
   {
     public:
 
-      void linearProgram4(const std::vector<Plane> &planes, std::size_t beginPlane,
-        float radius, Eigen::Vector3f &result);
+      void linearProgram4(const std::vector<Plane> &planes, std::size_t numObstPlanes,
+        std::size_t beginPlane, float radius, Eigen::Vector3f &result);
 
       std::size_t linearProgram3(const std::vector<Plane> &planes, float radius,
         const Eigen::Vector3f &optVelocity, bool directionOpt, Eigen::Vector3f &result);
@@ -123,13 +137,28 @@ namespace RVO
         : id_(id), timeStep_(timeStep), maxNeighbors_(maxNeighbors),
         maxSpeed_(maxSpeed), neighborDist_(neighborDist),
         radius_(radius), timeHorizon_(timeHorizon), 
-        minHeight_(minHeight), maxHeight_(maxHeight_){};
+        minHeight_(minHeight), maxHeight_(maxHeight)
+      {
+        /* Sized once here so that planning does not allocate per tick. */
+        agentNeighbors_.reserve(maxNeighbors_);
+        obstacleNeighbors_.reserve(maxNeighbors_);
+        /* One plane per obstacle neighbour and per agent neighbour. */
+        orcaPlanes_.reserve(2U * maxNeighbors_);
+        projPlanes_.reserve(2U * maxNeighbors_);
+        neighborBuffer_.reserve(maxNeighbors_);
+        planeBuffer_.reserve(maxNeighbors_);
+      };
 
       /**
        * @brief Destroys this agent instance.
        */
       ~Agent() {};
 
+      /* Moved rather than copied so that the reserved storage is kept. */
+      Agent(Agent &&other) = default;
+
+      Agent &operator=(Agent &&other) = default;
+
       /**
        * @brief Computes the new velocity of this agent.
        */
@@ -139,25 +168,39 @@ namespace RVO
 
       /**
        * @brief     Inserts an agent neighbor into the set of neighbors of this
-       *            agent.
-       * @param[in] agent   A pointer to the agent to be inserted.
-       * @param[in] rangeSq The squared range around this agent.
+       *            agent, keeping only the maxNeighbors_ closest ones.
+       * @param[in] agent   The agent to be inserted.
+       * @param[in] rangeSq The squared range around this agent, shrunk to the
+       *                    farthest kept neighbour once the set is full.
        */
-      void insertAgentNeighbor(const Eval_agent agent,
+      void insertAgentNeighbor(const Eval_agent &agent,
                               float &rangeSq); /* NOLINT(runtime/references) */
 
+      void clearObstacleNeighbor();
+
+      /**
+       * @brief     Inserts a static obstacle into the set of obstacle
+       *            neighbors of this agent if its closest point is in range,
+       *            keeping only the maxNeighbors_ closest ones.
+       * @param[in] obstacle The obstacle to be inserted.
+       * @param[in] rangeSq  The squared range around this agent.
+       */
+      void insertObstacleNeighbor(const Eval_obstacle &obstacle,
+                                  float rangeSq);
+
       /**
        * @brief Updates the three-dimensional position and three-dimensional
        *        velocity of this agent.
        */
       void update();
 
-      Eigen::Vector3f getVelocity() {return newVelocity_;};
+      const Eigen::Vector3f &getVelocity() const {return newVelocity_;};
 
-      bool noNeighbours() {return agentNeighbors_.empty();};
+      bool noNeighbours() const 
+      {return agentNeighbors_.empty() && obstacleNeighbors_.empty();};
 
-      void updateState(Eigen::Vector3f pos, 
-        Eigen::Vector3f vel, Eigen::Vector3f pref_vel);
+      void updateState(const Eigen::Vector3f &pos, 
+        const Eigen::Vector3f &vel, const Eigen::Vector3f &pref_vel);
 
     private:
 
@@ -180,8 +223,14 @@ namespace RVO
       float timeStep_;
       float minHeight_;
       float maxHeight_;
-      std::vector<std::pair<float, const Eval_agent>> agentNeighbors_;
+      std::vector<std::pair<float, Eval_agent>> agentNeighbors_;
+      /* Squared distance and closest point of each obstacle in range. */
+      std::vector<std::pair<float, Eigen::Vector3f>> obstacleNeighbors_;
       std::vector<Plane> orcaPlanes_;
+      /* Scratch for linearProgram4, reused for every failed plane. */
+      std::vector<Plane> projPlanes_;
+      NeighborBuffer neighborBuffer_;
+      PlaneBuffer planeBuffer_;
 
   };
 } /* namespace RVO */
@@ -0,0 +1,296 @@
+/*
+ * orca_planes.cc (modified)
+ * RVO2-3D Library
+ *
+ * SPDX-FileCopyrightText: 2008 University of North Carolina at Chapel Hill
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/RVO2/>
+ */
+
+#include "orca_planes.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace RVO
+{
+  namespace
+  {
+    std::size_t paddedSize(std::size_t count) {
+      return (count + RVO3D_ORCA_LANES - 1U) / RVO3D_ORCA_LANES * RVO3D_ORCA_LANES;
+    }
+
+#if defined(__AVX__)
+    /**
+     * @brief Eight floats in an AVX register, comparisons return bit masks.
+     */
+    struct Lanes {
+      static const std::size_t width = 8U;
+      __m256 v;
+
+      static Lanes load(const float *p) { return {_mm256_loadu_ps(p)}; }
+      static Lanes set(float f) { return {_mm256_set1_ps(f)}; }
+      void store(float *p) const { _mm256_storeu_ps(p, v); }
+
+      friend Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+      friend Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+      friend Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+      friend Lanes operator/(Lanes a, Lanes b) { return {_mm256_div_ps(a.v, b.v)}; }
+      friend Lanes operator<(Lanes a, Lanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+      friend Lanes operator>(Lanes a, Lanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+      friend Lanes operator&(Lanes a, Lanes b) { return {_mm256_and_ps(a.v, b.v)}; }
+      friend Lanes sqrt(Lanes a) { return {_mm256_sqrt_ps(a.v)}; }
+      /* Picks a where the mask is set and b otherwise. */
+      friend Lanes select(Lanes mask, Lanes a, Lanes b) {
+        return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+      }
+    };
+#elif defined(__SSE2__)
+    /**
+     * @brief Four floats in an SSE register, comparisons return bit masks.
+     */
+    struct Lanes {
+      static const std::size_t width = 4U;
+      __m128 v;
+
+      static Lanes load(const float *p) { return {_mm_loadu_ps(p)}; }
+      static Lanes set(float f) { return {_mm_set1_ps(f)}; }
+      void store(float *p) const { _mm_storeu_ps(p, v); }
+
+      friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+      friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+      friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+      friend Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+      friend Lanes operator<(Lanes a, Lanes b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+      friend Lanes operator>(Lanes a, Lanes b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+      friend Lanes operator&(Lanes a, Lanes b) { return {_mm_and_ps(a.v, b.v)}; }
+      friend Lanes sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+      /* Picks a where the mask is set and b otherwise. */
+      friend Lanes select(Lanes mask, Lanes a, Lanes b) {
+        return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+      }
+    };
+#endif
+  } /* namespace */
+
+  void NeighborBuffer::resize(std::size_t count) {
+    const std::size_t padded = paddedSize(count);
+
+    for (std::vector<float> *v : {&px, &py, &pz, &vx, &vy, &vz, &radius}) {
+      v->resize(padded);
+      std::fill(v->begin() + count, v->end(), 0.0F);
+    }
+
+    size = count;
+  }
+
+  void PlaneBuffer::resize(std::size_t count) {
+    const std::size_t padded = paddedSize(count);
+
+    for (std::vector<float> *v : {&nx, &ny, &nz, &px, &py, &pz}) {
+      v->resize(padded);
+    }
+  }
+
+  void NeighborBuffer::reserve(std::size_t count) {
+    const std::size_t padded = paddedSize(count);
+
+    for (std::vector<float> *v : {&px, &py, &pz, &vx, &vy, &vz, &radius}) {
+      v->reserve(padded);
+    }
+  }
+
+  void PlaneBuffer::reserve(std::size_t count) {
+    const std::size_t padded = paddedSize(count);
+
+    for (std::vector<float> *v : {&nx, &ny, &nz, &px, &py, &pz}) {
+      v->reserve(padded);
+    }
+  }
+
+  void buildOrcaPlanesScalar(const NeighborBuffer &neighbors,
+                             const Eigen::Vector3f &position,
+                             const Eigen::Vector3f &velocity, float radius,
+                             float timeHorizon, float timeStep,
+                             PlaneBuffer &planes) { /* NOLINT(runtime/references) */
+    planes.resize(neighbors.size);
+    const float invTimeHorizon = 1.0F / timeHorizon;
+
+    for (std::size_t i = 0U; i < neighbors.size; ++i) {
+      const Eigen::Vector3f relativePosition =
+          Eigen::Vector3f(neighbors.px[i], neighbors.py[i], neighbors.pz[i]) - position;
+      const Eigen::Vector3f relativeVelocity =
+          velocity - Eigen::Vector3f(neighbors.vx[i], neighbors.vy[i], neighbors.vz[i]);
+      const float distSq = relativePosition.dot(relativePosition);
+      const float combinedRadius = radius + neighbors.radius[i];
+      const float combinedRadiusSq = combinedRadius * combinedRadius;
+
+      Eigen::Vector3f normal;
+      Eigen::Vector3f u;
+
+      if (distSq > combinedRadiusSq) {
+        /* No collision. */
+        const Eigen::Vector3f w = relativeVelocity - invTimeHorizon * relativePosition;
+        /* Vector from cutoff center to relative velocity. */
+        const float wLengthSq = w.dot(w);
+
+        const float dotProduct = w.dot(relativePosition);
+
+        if (dotProduct < 0.0F &&
+            dotProduct * dotProduct > combinedRadiusSq * wLengthSq) {
+          /* Project on cut-off circle. */
+          const float wLength = std::sqrt(wLengthSq);
+          const Eigen::Vector3f unitW = w / wLength;
+
+          normal = unitW;
+          u = (combinedRadius * invTimeHorizon - wLength) * unitW;
+        } else {
+          /* Project on cone. */
+          const float a = distSq;
+          const float b = relativePosition.dot(relativeVelocity);
+          const float c = relativeVelocity.dot(relativeVelocity) -
+                          relativePosition.cross(relativeVelocity).squaredNorm() /
+                              (distSq - combinedRadiusSq);
+          const float t = (b + std::sqrt(b * b - a * c)) / a;
+          const Eigen::Vector3f ww = relativeVelocity - t * relativePosition;
+          const float wwLength = ww.norm();
+          const Eigen::Vector3f unitWW = ww / wwLength;
+
+          normal = unitWW;
+          u = (combinedRadius * t - wwLength) * unitWW;
+        }
+      } else {
+        /* Collision. */
+        const float invTimeStep = 1.0F / timeStep;
+        const Eigen::Vector3f w = relativeVelocity - invTimeStep * relativePosition;
+        const float wLength = w.norm();
+        const Eigen::Vector3f unitW = w / wLength;
+
+        normal = unitW;
+        u = (combinedRadius * invTimeStep - wLength) * unitW;
+      }
+
+      const Eigen::Vector3f point = velocity + 0.5F * u;
+      planes.nx[i] = normal.x();
+      planes.ny[i] = normal.y();
+      planes.nz[i] = normal.z();
+      planes.px[i] = point.x();
+      planes.py[i] = point.y();
+      planes.pz[i] = point.z();
+    }
+  }
+
+  void buildOrcaPlanes(const NeighborBuffer &neighbors,
+                       const Eigen::Vector3f &position,
+                       const Eigen::Vector3f &velocity, float radius,
+                       float timeHorizon, float timeStep,
+                       PlaneBuffer &planes) { /* NOLINT(runtime/references) */
+#if defined(__AVX__) || defined(__SSE2__)
+    planes.resize(neighbors.size);
+
+    /* All three cases share the form w = relVel - k * relPos,
+     * normal = w / |w| and u = (combinedRadius * k - |w|) * normal, where k
+     * is 1/timeStep on collision, 1/timeHorizon on the cut-off circle and
+     * the cone tangent t otherwise. Every k is computed and the lane masks
+     * pick the right one, the discarded lanes may hold NaN.
+     */
+    const Lanes zero = Lanes::set(0.0F);
+    const Lanes half = Lanes::set(0.5F);
+    const Lanes one = Lanes::set(1.0F);
+    const Lanes invTimeHorizon = Lanes::set(1.0F / timeHorizon);
+    const Lanes invTimeStep = Lanes::set(1.0F / timeStep);
+    const Lanes ownRadius = Lanes::set(radius);
+    const Lanes posX = Lanes::set(position.x());
+    const Lanes posY = Lanes::set(position.y());
+    const Lanes posZ = Lanes::set(position.z());
+    const Lanes velX = Lanes::set(velocity.x());
+    const Lanes velY = Lanes::set(velocity.y());
+    const Lanes velZ = Lanes::set(velocity.z());
+
+    for (std::size_t i = 0U; i < neighbors.size; i += Lanes::width) {
+      const Lanes rpX = Lanes::load(&neighbors.px[i]) - posX;
+      const Lanes rpY = Lanes::load(&neighbors.py[i]) - posY;
+      const Lanes rpZ = Lanes::load(&neighbors.pz[i]) - posZ;
+      const Lanes rvX = velX - Lanes::load(&neighbors.vx[i]);
+      const Lanes rvY = velY - Lanes::load(&neighbors.vy[i]);
+      const Lanes rvZ = velZ - Lanes::load(&neighbors.vz[i]);
+
+      const Lanes distSq = rpX * rpX + rpY * rpY + rpZ * rpZ;
+      const Lanes combinedRadius = ownRadius + Lanes::load(&neighbors.radius[i]);
+      const Lanes combinedRadiusSq = combinedRadius * combinedRadius;
+
+      /* Cut-off circle test. */
+      const Lanes wX = rvX - invTimeHorizon * rpX;
+      const Lanes wY = rvY - invTimeHorizon * rpY;
+      const Lanes wZ = rvZ - invTimeHorizon * rpZ;
+      const Lanes wLengthSq = wX * wX + wY * wY + wZ * wZ;
+      const Lanes dotProduct = wX * rpX + wY * rpY + wZ * rpZ;
+      const Lanes onCutoff = (dotProduct < zero) &
+          (dotProduct * dotProduct > combinedRadiusSq * wLengthSq);
+
+      /* Cone tangent. */
+      const Lanes b = rpX * rvX + rpY * rvY + rpZ * rvZ;
+      const Lanes crossX = rpY * rvZ - rpZ * rvY;
+      const Lanes crossY = rpZ * rvX - rpX * rvZ;
+      const Lanes crossZ = rpX * rvY - rpY * rvX;
+      const Lanes c = (rvX * rvX + rvY * rvY + rvZ * rvZ) -
+          (crossX * crossX + crossY * crossY + crossZ * crossZ) /
+          (distSq - combinedRadiusSq);
+      const Lanes t = (b + sqrt(b * b - distSq * c)) / distSq;
+
+      Lanes k = select(onCutoff, invTimeHorizon, t);
+      k = select(distSq > combinedRadiusSq, k, invTimeStep);
+
+      const Lanes uX = rvX - k * rpX;
+      const Lanes uY = rvY - k * rpY;
+      const Lanes uZ = rvZ - k * rpZ;
+      const Lanes uLength = sqrt(uX * uX + uY * uY + uZ * uZ);
+      const Lanes invLength = one / uLength;
+      const Lanes normalX = uX * invLength;
+      const Lanes normalY = uY * invLength;
+      const Lanes normalZ = uZ * invLength;
+      const Lanes scale = half * (combinedRadius * k - uLength);
+
+      normalX.store(&planes.nx[i]);
+      normalY.store(&planes.ny[i]);
+      normalZ.store(&planes.nz[i]);
+      (velX + scale * normalX).store(&planes.px[i]);
+      (velY + scale * normalY).store(&planes.py[i]);
+      (velZ + scale * normalZ).store(&planes.pz[i]);
+    }
+#else
+    buildOrcaPlanesScalar(neighbors, position, velocity, radius, timeHorizon,
+                          timeStep, planes);
+#endif
+  }
+} /* namespace RVO */
@@ -0,0 +1,119 @@
+/*
+ * orca_planes.h (modified)
+ * RVO2-3D Library
+ *
+ * SPDX-FileCopyrightText: 2008 University of North Carolina at Chapel Hill
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO3D_ORCA_PLANES_H_
+#define RVO3D_ORCA_PLANES_H_
+
+/**
+ * @file  orca_planes.h
+ * @brief Contains the batched agent ORCA plane construction.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace RVO
+{
+  /**
+   * @brief Number of neighbours processed together, the buffers are padded
+   *        to a multiple of this.
+   */
+  const std::size_t RVO3D_ORCA_LANES = 8U;
+
+  /**
+   * @brief Neighbour positions, velocities and radii in structure of arrays
+   *        form.
+   */
+  struct NeighborBuffer
+  {
+    std::vector<float> px, py, pz;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> radius;
+    std::size_t size = 0U;
+
+    /**
+     * @brief     Sets the number of neighbours, the padding is zero filled.
+     * @param[in] count The number of neighbours.
+     */
+    void resize(std::size_t count);
+
+    /**
+     * @brief     Allocates room for a number of neighbours up front.
+     * @param[in] count The number of neighbours.
+     */
+    void reserve(std::size_t count);
+  };
+
+  /**
+   * @brief ORCA planes in structure of arrays form.
+   */
+  struct PlaneBuffer
+  {
+    std::vector<float> nx, ny, nz;
+    std::vector<float> px, py, pz;
+
+    void resize(std::size_t count);
+
+    void reserve(std::size_t count);
+  };
+
+  /**
+   * @brief      Builds the agent ORCA plane of every neighbour, several
+   *             neighbours at a time with SSE or AVX when it is available.
+   * @param[in]  neighbors      The neighbours of the agent.
+   * @param[in]  position       The position of the agent.
+   * @param[in]  velocity       The velocity of the agent.
+   * @param[in]  radius         The radius of the agent.
+   * @param[in]  timeHorizon    The time horizon of the agent.
+   * @param[in]  timeStep       The time step of the agent.
+   * @param[out] planes         One plane per neighbour.
+   */
+  void buildOrcaPlanes(const NeighborBuffer &neighbors,
+                       const Eigen::Vector3f &position,
+                       const Eigen::Vector3f &velocity, float radius,
+                       float timeHorizon, float timeStep,
+                       PlaneBuffer &planes); /* NOLINT(runtime/references) */
+
+  /**
+   * @brief Same as buildOrcaPlanes, one neighbour at a time.
+   */
+  void buildOrcaPlanesScalar(const NeighborBuffer &neighbors,
+                             const Eigen::Vector3f &position,
+                             const Eigen::Vector3f &velocity, float radius,
+                             float timeHorizon, float timeStep,
+                             PlaneBuffer &planes); /* NOLINT(runtime/references) */
+} /* namespace RVO */
+
+#endif /* RVO3D_ORCA_PLANES_H_ */
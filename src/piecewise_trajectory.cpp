@@ -0,0 +1,129 @@
+/*
+* piecewise_trajectory.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "piecewise_trajectory.h"
+
+#include <cmath>
+
+using common::polynomial_piece;
+
+namespace
+{
+    // s(u) = 35u^4 - 84u^5 + 70u^6 - 20u^7, at rest with no acceleration
+    // or jerk at both ends, its rate peaks at u = 0.5
+    const double smoothstep[polynomial_piece::coefficients] = 
+        {0.0, 0.0, 0.0, 0.0, 35.0, -84.0, 70.0, -20.0};
+    const double peak_rate = 35.0 / 16.0;
+
+    double evaluate(const double *c, double t)
+    {
+        double value = 0.0;
+        for (size_t k = polynomial_piece::coefficients; k-- > 0;)
+            value = value * t + c[k];
+        return value;
+    }
+
+    double derivative(const double *c, double t)
+    {
+        double value = 0.0;
+        for (size_t k = polynomial_piece::coefficients; k-- > 1;)
+            value = value * t + (double)k * c[k];
+        return value;
+    }
+
+    /** @brief p(t) = start + (end - start) s(t / duration) **/
+    void segment(double *c, double start, double end, double duration)
+    {
+        double scale = 1.0;
+        for (size_t k = 0; k < polynomial_piece::coefficients; k++)
+        {
+            c[k] = (end - start) * smoothstep[k] / scale;
+            scale *= duration;
+        }
+        c[0] += start;
+    }
+}
+
+common::piecewise_trajectory::piecewise_trajectory(
+    const Eigen::Vector3d &start, const std::vector<Eigen::Vector3d> &waypoints, 
+    double max_velocity, double yaw)
+{
+    Eigen::Vector3d from = start;
+    for (const Eigen::Vector3d &to : waypoints)
+    {
+        double distance = (to - from).norm();
+        // waypoints on top of each other add nothing
+        if (distance < 1e-6)
+            continue;
+
+        polynomial_piece piece;
+        piece.duration = peak_rate * distance / max_velocity;
+        segment(piece.x, from.x(), to.x(), piece.duration);
+        segment(piece.y, from.y(), to.y(), piece.duration);
+        segment(piece.z, from.z(), to.z(), piece.duration);
+        segment(piece.yaw, yaw, yaw, piece.duration);
+        segments.push_back(piece);
+
+        from = to;
+    }
+}
+
+double common::piecewise_trajectory::duration() const
+{
+    double total = 0.0;
+    for (const polynomial_piece &piece : segments)
+        total += piece.duration;
+    return total;
+}
+
+const polynomial_piece *common::piecewise_trajectory::find(double &t) const
+{
+    if (segments.empty())
+        return nullptr;
+
+    t = std::max(t, 0.0);
+    for (const polynomial_piece &piece : segments)
+    {
+        if (t <= piece.duration)
+            return &piece;
+        t -= piece.duration;
+    }
+
+    t = segments.back().duration;
+    return &segments.back();
+}
+
+Eigen::Vector3d common::piecewise_trajectory::position(double t) const
+{
+    const polynomial_piece *piece = find(t);
+    if (piece == nullptr)
+        return Eigen::Vector3d::Zero();
+
+    return Eigen::Vector3d(evaluate(piece->x, t), 
+        evaluate(piece->y, t), evaluate(piece->z, t));
+}
+
+Eigen::Vector3d common::piecewise_trajectory::velocity(double t) const
+{
+    const polynomial_piece *piece = find(t);
+    if (piece == nullptr)
+        return Eigen::Vector3d::Zero();
+
+    return Eigen::Vector3d(derivative(piece->x, t), 
+        derivative(piece->y, t), derivative(piece->z, t));
+}
@@ -0,0 +1,110 @@
+/*
+* pose_history.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "pose_history.h"
+
+#include <algorithm>
+
+common::pose_history::pose_history(size_t capacity) :
+    capacity(std::max(capacity, (size_t)2)),
+    slots(new seqlock<entry>[std::max(capacity, (size_t)2)])
+{
+}
+
+void common::pose_history::push(const pose_sample &sample)
+{
+    while (writing.test_and_set(std::memory_order_acquire))
+        ;
+
+    if (sample.stamp >= newest_stamp)
+    {
+        uint64_t sequence = head.load(std::memory_order_relaxed);
+        slots[sequence % capacity].store({sequence, sample});
+        head.store(sequence + 1, std::memory_order_release);
+        newest_stamp = sample.stamp;
+    }
+
+    writing.clear(std::memory_order_release);
+}
+
+bool common::pose_history::read(uint64_t sequence, entry &e) const
+{
+    e = slots[sequence % capacity].load();
+    return e.sequence == sequence;
+}
+
+bool common::pose_history::sample_at(
+    int64_t stamp, int64_t tolerance, pose_sample &result) const
+{
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+
+    // first sample newer than the stamp
+    uint64_t low = begin, high = end;
+    entry e;
+    while (low < high)
+    {
+        uint64_t middle = low + (high - low) / 2;
+        if (!read(middle, e) || e.pose.stamp <= stamp)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    entry before, after;
+    bool has_before = low > begin && read(low - 1, before);
+    bool has_after = low < end && read(low, after);
+
+    if (has_before && has_after)
+    {
+        int64_t to_before = stamp - before.pose.stamp;
+        int64_t to_after = after.pose.stamp - stamp;
+        if (std::min(to_before, to_after) > tolerance)
+            return false;
+
+        double s = (double)to_before / (double)(to_before + to_after);
+
+        Eigen::Map<const Eigen::Vector3d> p0(before.pose.position);
+        Eigen::Map<const Eigen::Vector3d> p1(after.pose.position);
+        Eigen::Map<Eigen::Vector3d>(result.position) = p0 + s * (p1 - p0);
+
+        const double *o0 = before.pose.orientation;
+        const double *o1 = after.pose.orientation;
+        Eigen::Quaterniond q = Eigen::Quaterniond(o0[0], o0[1], o0[2], o0[3]).slerp(
+            s, Eigen::Quaterniond(o1[0], o1[1], o1[2], o1[3]));
+        result.orientation[0] = q.w();
+        result.orientation[1] = q.x();
+        result.orientation[2] = q.y();
+        result.orientation[3] = q.z();
+        result.stamp = stamp;
+        return true;
+    }
+
+    // outside of the ring, no extrapolation
+    if (has_before && stamp - before.pose.stamp <= tolerance)
+    {
+        result = before.pose;
+        return true;
+    }
+    if (has_after && after.pose.stamp - stamp <= tolerance)
+    {
+        result = after.pose;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,167 @@
+/*
+* pose_smoother.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "pose_smoother.h"
+#include "common.h"
+
+#include <algorithm>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/BetweenFactor.h>
+
+using gtsam::symbol_shorthand::X; // state estimate
+using gtsam::symbol_shorthand::Z; // measurement (marker)
+
+common::pose_smoother::pose_smoother(size_t window, double sigma) :
+    window(std::max(window, (size_t)1)),
+    noise(gtsam::noiseModel::Diagonal::Sigmas(gtsam::Vector6::Constant(sigma)))
+{
+}
+
+void common::pose_smoother::update(const std::vector<smoother_state> &states)
+{
+    if (states.empty())
+        return;
+
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values initial;
+
+    for (const smoother_state &state : states)
+    {
+        entry e;
+        e.x = next_x++;
+        e.recorded = state.recorded;
+
+        initial.insert(X(e.x), state.initial);
+
+        for (const auto &[l, measurement] : state.landmarks)
+        {
+            gtsam::Key z = Z(next_z++);
+            e.factors.addPrior(z, l->prior, l->prior_noise);
+            // tag to body
+            e.factors.add(gtsam::BetweenFactor<gtsam::Pose3>(
+                X(e.x), z, measurement, noise));
+            initial.insert(z, l->prior);
+            e.landmark_keys.push_back(z);
+        }
+
+        // x(i-1) -> x(i)
+        if (has_previous)
+            e.odometry.add(gtsam::BetweenFactor<gtsam::Pose3>(
+                X(e.x - 1), X(e.x), previous_initial.inverse() * state.initial, noise));
+
+        previous_initial = state.initial;
+        has_previous = true;
+
+        graph.push_back(e.factors);
+        graph.push_back(e.odometry);
+        entries.push_back(std::move(e));
+    }
+
+    isam.update(graph, initial);
+
+    if (entries.size() >= 2 * window)
+        marginalize();
+}
+
+void common::pose_smoother::marginalize()
+{
+    gtsam::Values estimate = isam.calculateEstimate();
+    size_t drop = entries.size() - window;
+
+    // the dropped states with the marginal before them, their marginal on
+    // the newest dropped state is all that is kept of the history
+    gtsam::NonlinearFactorGraph dropped_graph = anchor;
+    gtsam::Values dropped_values;
+    if (has_anchor)
+        dropped_values.insert(X(anchor_x), estimate.at<gtsam::Pose3>(X(anchor_x)));
+
+    for (size_t i = 0; i < drop; i++)
+    {
+        const entry &e = entries[i];
+        dropped_graph.push_back(e.factors);
+        dropped_graph.push_back(e.odometry);
+        dropped_values.insert(X(e.x), estimate.at<gtsam::Pose3>(X(e.x)));
+        for (gtsam::Key z : e.landmark_keys)
+            dropped_values.insert(z, estimate.at<gtsam::Pose3>(z));
+    }
+
+    gtsam::Key last = X(entries[drop - 1].x);
+    gtsam::Marginals marginals(dropped_graph, dropped_values);
+
+    anchor = gtsam::NonlinearFactorGraph();
+    anchor.addPrior(last, estimate.at<gtsam::Pose3>(last),
+        gtsam::noiseModel::Gaussian::Covariance(marginals.marginalCovariance(last)));
+    anchor_x = entries[drop - 1].x;
+    has_anchor = true;
+
+    entries.erase(entries.begin(), entries.begin() + drop);
+
+    // start over with the marginal and the states left in the window
+    gtsam::NonlinearFactorGraph graph = anchor;
+    gtsam::Values values;
+    values.insert(last, estimate.at<gtsam::Pose3>(last));
+    for (const entry &e : entries)
+    {
+        graph.push_back(e.factors);
+        graph.push_back(e.odometry);
+        values.insert(X(e.x), estimate.at<gtsam::Pose3>(X(e.x)));
+        for (gtsam::Key z : e.landmark_keys)
+            values.insert(z, estimate.at<gtsam::Pose3>(z));
+    }
+
+    isam = gtsam::ISAM2();
+    isam.update(graph, values);
+}
+
+bool common::pose_smoother::correction(
+    Eigen::Vector3d &translation, Eigen::Quaterniond &rotation)
+{
+    std::vector<Eigen::Vector4f> quaternions_error_vector;
+    translation = Eigen::Vector3d::Zero();
+    rotation = Eigen::Quaterniond::Identity();
+
+    for (const entry &e : entries)
+    {
+        if (e.x < corrected_x)
+            continue;
+
+        gtsam::Pose3 opt_pose = isam.calculateEstimate<gtsam::Pose3>(X(e.x));
+        translation += Eigen::Vector3d(
+            opt_pose.x() - e.recorded.x(),
+            opt_pose.y() - e.recorded.y(),
+            opt_pose.z() - e.recorded.z());
+
+        Eigen::Quaterniond q_curr(e.recorded.rotation().matrix());
+        Eigen::Quaterniond q_opt(opt_pose.rotation().matrix());
+
+        // get the difference/error in quaternions
+        Eigen::Quaterniond q_diff = q_opt * q_curr.inverse();
+
+        quaternions_error_vector.emplace_back(quat_to_vec4(q_diff));
+    }
+
+    if (quaternions_error_vector.empty())
+        return false;
+    corrected_x = next_x;
+
+    translation /= (double)quaternions_error_vector.size();
+    rotation = vec4_to_quat(quaternion_average(quaternions_error_vector));
+    return true;
+}
@@ -0,0 +1,301 @@
+/*
+* headless_sim.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "headless_sim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+common::headless_sim::headless_sim(const sim_config &configuration)
+    : config(configuration), planner(configuration.planner), generator(configuration.seed)
+{
+    switch (config.scenario)
+    {
+        case CIRCLE_SWAP:
+            setup_circle_swap();
+            break;
+        case CORRIDOR:
+            setup_corridor();
+            break;
+        case RANDOM_GOALS:
+            setup_random_goals();
+            break;
+    }
+
+    velocity.assign(position.size(), Eigen::Vector3d::Zero());
+    reached.assign(position.size(), 0);
+    velocity_commands.reserve(position.size());
+
+    for (size_t i = 0; i < position.size(); i++)
+        planner.add_agent(i);
+
+    collision_grid.set_cell_size((float)(2.0 * config.planner.protected_zone));
+    collision_grid.reserve(position.size());
+    collision_points.resize(position.size());
+}
+
+std::string common::headless_sim::scenario_name(sim_scenario scenario)
+{
+    switch (scenario)
+    {
+        case CIRCLE_SWAP:
+            return "circle_swap";
+        case CORRIDOR:
+            return "corridor";
+        case RANDOM_GOALS:
+            return "random_goals";
+    }
+    return "";
+}
+
+void common::headless_sim::setup_circle_swap()
+{
+    // spread the agents so that neighbours start 3 protected zones apart
+    double spacing = 3.0 * config.planner.protected_zone;
+    double radius = std::max(2.0, config.agents * spacing / (2.0 * M_PI));
+
+    // a small jitter of the angles breaks the symmetry that deadlocks ORCA
+    std::uniform_real_distribution<double> jitter(-0.01, 0.01);
+
+    for (size_t i = 0; i < config.agents; i++)
+    {
+        double angle = 2.0 * M_PI * (double)i / (double)config.agents +
+            jitter(generator) / radius;
+        Eigen::Vector3d p(radius * std::cos(angle), radius * std::sin(angle), 
+            1.0 + jitter(generator));
+        position.push_back(p);
+        goal.push_back(Eigen::Vector3d(-p.x(), -p.y(), p.z()));
+    }
+}
+
+void common::headless_sim::setup_corridor()
+{
+    // agents start in a block at either end and fly to the block opposite
+    double spacing = 3.0 * config.planner.protected_zone;
+    double width = 2.0;
+    double length = 10.0;
+    size_t lanes = std::max((size_t)1, (size_t)(width / spacing) - 1);
+    size_t layers = 3;
+    size_t per_block = lanes * layers;
+
+    // the right block flies its lanes half a spacing over, and a jitter
+    // breaks what is left of the symmetry, head on lanes deadlock ORCA
+    std::uniform_real_distribution<double> jitter(-0.1 * spacing, 0.1 * spacing);
+
+    for (size_t i = 0; i < config.agents; i++)
+    {
+        bool left = i % 2 == 0;
+        size_t k = i / 2;
+        size_t row = k / per_block;
+        size_t lane = k % lanes;
+        size_t layer = (k / lanes) % layers;
+
+        double x = -(length / 2.0 + spacing * (double)(row + 1));
+        double y = -width / 2.0 + spacing * (double)(lane + 1) + 
+            (left ? 0.0 : 0.5 * spacing) + jitter(generator);
+        double z = 0.5 + spacing * (double)layer + jitter(generator);
+        Eigen::Vector3d p(left ? x : -x, y, z);
+        position.push_back(p);
+        goal.push_back(Eigen::Vector3d(-p.x(), p.y(), p.z()));
+    }
+
+    std::vector<RVO::Eval_obstacle> walls;
+    for (double side : {-width / 2.0, width / 2.0})
+    {
+        RVO::Eval_obstacle wall;
+        wall.start_ = Eigen::Vector2f(-(float)length / 2.0f, (float)side);
+        wall.end_ = Eigen::Vector2f((float)length / 2.0f, (float)side);
+        wall.minHeight_ = (float)config.planner.height_range.first;
+        wall.maxHeight_ = (float)config.planner.height_range.second;
+        walls.push_back(wall);
+    }
+    planner.set_obstacles(walls);
+}
+
+void common::headless_sim::setup_random_goals()
+{
+    // about one agent per cubic metre
+    double side = std::max(4.0, std::cbrt((double)config.agents));
+    random_min = Eigen::Vector3d(-side / 2.0, -side / 2.0, 0.5);
+    random_max = Eigen::Vector3d(side / 2.0, side / 2.0, 
+        0.5 + std::min(side, config.planner.height_range.second - 1.0));
+
+    // starts and goals that overlap would count as collisions of the
+    // harness, not of the planner
+    for (size_t i = 0; i < config.agents; i++)
+    {
+        position.push_back(random_point(position, i));
+        goal.push_back(random_point(goal, i));
+    }
+}
+
+Eigen::Vector3d common::headless_sim::random_point(
+    const std::vector<Eigen::Vector3d> &apart, size_t skip)
+{
+    const double separation_sq = 
+        4.0 * config.planner.protected_zone * config.planner.protected_zone;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    // rejection sampling, in a space too full the last draw is kept
+    Eigen::Vector3d p;
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        for (int k = 0; k < 3; k++)
+            p[k] = random_min[k] + unit(generator) * (random_max[k] - random_min[k]);
+
+        bool clear = true;
+        for (size_t j = 0; j < apart.size() && clear; j++)
+            clear = j == skip || (apart[j] - p).squaredNorm() >= separation_sq;
+        if (clear)
+            break;
+    }
+    return p;
+}
+
+double common::headless_sim::step()
+{
+    const double max_velocity = config.planner.max_velocity;
+    const double dt = config.planner.time_step;
+
+    velocity_commands.clear();
+
+    // same target following as MOVE_VELOCITY in the handler
+    for (size_t i = 0; i < position.size(); i++)
+    {
+        double pose_difference = (goal[i] - position[i]).norm();
+
+        Eigen::Vector3d vel_target;
+        bool plan = false;
+
+        if (pose_difference < config.reached_threshold)
+        {
+            vel_target = Eigen::Vector3d::Zero();
+            if (config.scenario == RANDOM_GOALS)
+            {
+                goal[i] = random_point(goal, i);
+                goals_reached++;
+            }
+            else
+                reached[i] = 1;
+        }
+        else if (pose_difference < max_velocity)
+        {
+            // planned too, unlike the handler
+            vel_target = goal[i] - position[i];
+            plan = true;
+        }
+        else
+        {
+            vel_target = (goal[i] - position[i]).normalized() * max_velocity;
+            plan = true;
+        }
+
+        velocity_commands.push_back({i, vel_target, goal[i].z(), plan});
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < position.size(); i++)
+        planner.set_state(i, position[i], velocity[i]);
+    planner.rebuild_neighbour_index();
+    planner.plan(velocity_commands);
+    auto end = std::chrono::steady_clock::now();
+
+    // the agents fly the command for one tick, as Agent::update does
+    for (const auto &command : velocity_commands)
+    {
+        velocity[command.index] = command.velocity;
+        position[command.index] += command.velocity * dt;
+    }
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+size_t common::headless_sim::count_collisions(double &min_separation)
+{
+    for (size_t i = 0; i < position.size(); i++)
+        collision_points[i] = position[i].cast<float>();
+    collision_grid.rebuild(collision_points);
+
+    const float separation = (float)(2.0 * config.planner.protected_zone);
+    size_t pairs = 0;
+    const float overlap_sq = 0.99f * 0.99f * separation * separation;
+    float min_sq = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < position.size(); i++)
+        collision_grid.for_each_in_range(collision_points[i], separation, i,
+            [&](size_t n, float dist_sq)
+            {
+                // each pair is seen from both sides, and ORCA holds agents
+                // right at the protected zone so touching is not counted
+                if (n < i)
+                    return;
+                min_sq = std::min(min_sq, dist_sq);
+                if (dist_sq < overlap_sq)
+                    pairs++;
+            });
+
+    if (min_sq < std::numeric_limits<float>::max())
+        min_separation = std::min(min_separation, (double)std::sqrt(min_sq));
+    return pairs;
+}
+
+common::sim_result common::headless_sim::run()
+{
+    sim_result result;
+    result.min_separation = std::numeric_limits<double>::infinity();
+
+    std::vector<double> latencies;
+    latencies.reserve(config.max_ticks);
+    double total = 0.0;
+
+    for (size_t tick = 0; tick < config.max_ticks; tick++)
+    {
+        double t = step();
+        latencies.push_back(t * 1000.0);
+        total += t;
+        result.collisions += count_collisions(result.min_separation);
+        result.ticks++;
+
+        if (config.scenario != RANDOM_GOALS &&
+            std::all_of(reached.begin(), reached.end(), [](uint8_t r) { return r != 0; }))
+            break;
+    }
+
+    result.arrived = (size_t)std::count(reached.begin(), reached.end(), 1);
+    result.goals_reached = goals_reached;
+
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p)
+        {
+            size_t k = (size_t)std::ceil(p * (double)latencies.size()) - 1;
+            return latencies[std::min(k, latencies.size() - 1)];
+        };
+        result.latency_p50 = percentile(0.50);
+        result.latency_p90 = percentile(0.90);
+        result.latency_p99 = percentile(0.99);
+        result.latency_max = latencies.back();
+    }
+
+    if (total > 0.0)
+        result.agent_ticks_per_second = (double)(result.ticks * position.size()) / total;
+
+    return result;
+}
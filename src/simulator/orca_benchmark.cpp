@@ -0,0 +1,68 @@
+/*
+* orca_benchmark.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "headless_sim.h"
+
+using namespace common;
+
+/**
+ * @brief runs every scenario of the headless simulator for a range of
+ * swarm sizes and prints one line per run, arrived is the goals reached
+ * for random goals
+ * usage: orca_benchmark [planning_threads] [max_ticks] [seed]
+**/
+int main(int argc, char * argv[])
+{
+    size_t threads = argc > 1 ? (size_t)std::atoi(argv[1]) : 1;
+    size_t max_ticks = argc > 2 ? (size_t)std::atoi(argv[2]) : 2000;
+    uint32_t seed = argc > 3 ? (uint32_t)std::atoi(argv[3]) : 1;
+
+    const std::vector<size_t> swarm_sizes = {10, 50, 100, 250, 500, 1000};
+    const std::vector<sim_scenario> scenarios = {CIRCLE_SWAP, CORRIDOR, RANDOM_GOALS};
+
+    printf("%-13s %5s %6s %8s %9s %9s %9s %9s %10s %8s %14s\n",
+        "scenario", "n", "ticks", "arrived", "p50(ms)", "p90(ms)", "p99(ms)", 
+        "max(ms)", "collisions", "min_sep", "agent_ticks/s");
+
+    for (auto scenario : scenarios)
+        for (size_t n : swarm_sizes)
+        {
+            sim_config config;
+            config.scenario = scenario;
+            config.agents = n;
+            config.seed = seed;
+            config.max_ticks = max_ticks;
+            config.planner.threads = threads;
+
+            headless_sim sim(config);
+            sim_result r = sim.run();
+            size_t arrived = scenario == RANDOM_GOALS ? r.goals_reached : r.arrived;
+
+            printf("%-13s %5zu %6zu %8zu %9.3f %9.3f %9.3f %9.3f %10zu %8.3f %14.0f\n",
+                headless_sim::scenario_name(scenario).c_str(), n, r.ticks, arrived,
+                r.latency_p50, r.latency_p90, r.latency_p99, r.latency_max,
+                r.collisions, r.min_separation, r.agent_ticks_per_second);
+            fflush(stdout);
+        }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+* spatial_grid.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "spatial_grid.h"
+
+#include <algorithm>
+
+void common::spatial_grid::set_cell_size(float size)
+{
+    cell_size = size > 0.0f ? size : 1.0f;
+    inv_cell_size = 1.0f / cell_size;
+}
+
+void common::spatial_grid::reserve(size_t n)
+{
+    // keep the load factor at 0.5 or lower
+    size_t buckets = 16;
+    while (buckets < 2 * n)
+        buckets <<= 1;
+
+    if (bucket_start.size() < buckets + 1)
+        bucket_start.resize(buckets + 1);
+    entries.reserve(n);
+    entry_bucket.reserve(n);
+}
+
+void common::spatial_grid::rebuild(
+    const std::vector<Eigen::Vector3f> &points)
+{
+    reserve(points.size());
+    bucket_mask = bucket_start.size() - 2;
+
+    entries.resize(points.size());
+    entry_bucket.resize(points.size());
+    std::fill(bucket_start.begin(), bucket_start.end(), 0);
+
+    // count the points per bucket, shifted by one for the prefix sum
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        entry_bucket[i] = hash(
+            cell_of(points[i].x()), cell_of(points[i].y()), cell_of(points[i].z()));
+        bucket_start[entry_bucket[i] + 1]++;
+    }
+
+    for (size_t b = 1; b < bucket_start.size(); b++)
+        bucket_start[b] += bucket_start[b-1];
+
+    // scatter using the bucket start as the write cursor, which leaves every
+    // start at the end of its bucket, hence shift them back into place after
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        uint32_t &cursor = bucket_start[entry_bucket[i]];
+        entries[cursor].position = points[i];
+        entries[cursor].index = (uint32_t)i;
+        cursor++;
+    }
+
+    for (size_t b = bucket_start.size() - 1; b > 0; b--)
+        bucket_start[b] = bucket_start[b-1];
+    bucket_start[0] = 0;
+}
+
+void common::spatial_grid::query_range(
+    const Eigen::Vector3f &p, float radius,
+    size_t exclude, std::vector<size_t> &result) const
+{
+    result.clear();
+    for_each_in_range(p, radius, exclude,
+        [&result](size_t index, float) { result.push_back(index); });
+}
@@ -0,0 +1,143 @@
+/*
+* swarm_planner.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "swarm_planner.h"
+#include "tracing.h"
+
+#include <algorithm>
+
+common::swarm_planner::swarm_planner(const planner_parameters &parameters)
+    : param(parameters)
+{
+    // static walls, a wall within reach in one planning horizon is a constraint
+    obstacle_range = param.max_velocity * param.time_horizon + param.protected_zone;
+
+    neighbour_grid.set_cell_size((float)param.communication_radius);
+    planning_pool = std::make_unique<worker_pool>(std::max(param.threads, (size_t)1));
+}
+
+size_t common::swarm_planner::add_agent(size_t id)
+{
+    size_t index = rvo_agents.size();
+
+    rvo_agents.emplace_back(
+        id, (float)param.time_step, param.max_neighbours, (float)param.max_velocity, 
+        (float)param.communication_radius, (float)param.protected_zone, 
+        (float)param.time_horizon,
+        (float)param.height_range.first, (float)param.height_range.second);
+
+    // pooled storage for the neighbour index, rebuilt every planning tick
+    neighbour_grid.reserve(rvo_agents.size());
+    neighbour_pool.resize(rvo_agents.size());
+    neighbour_points.resize(rvo_agents.size());
+
+    return index;
+}
+
+void common::swarm_planner::set_obstacles(const std::vector<RVO::Eval_obstacle> &walls)
+{
+    obstacle_pool = walls;
+
+    std::vector<std::pair<Eigen::Vector2f, Eigen::Vector2f>> segments;
+    for (const auto &wall : obstacle_pool)
+        segments.emplace_back(wall.start_, wall.end_);
+    obstacle_walls.build(segments, (float)obstacle_range);
+}
+
+void common::swarm_planner::set_state(size_t index, 
+    const Eigen::Vector3d &position, const Eigen::Vector3d &velocity)
+{
+    RVO::Eval_agent &node = neighbour_pool[index];
+    node.position_ = position.cast<float>();
+    node.velocity_ = velocity.cast<float>();
+    node.radius_ = (float)param.protected_zone;
+    neighbour_points[index] = node.position_;
+}
+
+void common::swarm_planner::rebuild_neighbour_index()
+{
+    neighbour_grid.rebuild(neighbour_points);
+}
+
+double common::swarm_planner::nearest_neighbour(size_t index) const
+{
+    float nearest_sq = (float)(param.communication_radius * param.communication_radius);
+    neighbour_grid.for_each_in_range(
+        neighbour_points[index], (float)param.communication_radius, index,
+        [&](size_t, float dist_sq)
+        {
+            nearest_sq = std::min(nearest_sq, dist_sq);
+        });
+    return std::sqrt((double)nearest_sq);
+}
+
+void common::swarm_planner::conduct_planning(velocity_command &command) 
+{
+    float communication_radius_float = (float)param.communication_radius;
+    float range_sq = communication_radius_float * communication_radius_float;
+    const RVO::Eval_agent &self = neighbour_pool[command.index];
+    RVO::Agent &rvo = rvo_agents[command.index];
+
+    // the state goes in first since the neighbours are ranked by their
+    // distance to this position
+    rvo.updateState(
+        self.position_, self.velocity_, 
+        command.velocity.cast<float>());
+
+    // clear agent neighbour before adding in new neighbours and obstacles
+    rvo.clearAgentNeighbor();
+
+    // the index is rebuilt once per tick by rebuild_neighbour_index,
+    // the agent keeps the closest maxNeighbors_ of these
+    neighbour_grid.for_each_in_range(
+        self.position_, communication_radius_float, command.index,
+        [&](size_t n, float)
+        {
+            rvo.insertAgentNeighbor(neighbour_pool[n], range_sq);
+        });
+
+    // walls near this agent, the grid holds them per cell so this does not
+    // depend on the number of walls in the room
+    float obstacle_range_sq = (float)(obstacle_range * obstacle_range);
+    rvo.clearObstacleNeighbor();
+    obstacle_walls.for_each_candidate(self.position_,
+        [&](size_t n)
+        {
+            rvo.insertObstacleNeighbor(obstacle_pool[n], obstacle_range_sq);
+        });
+
+    if (!rvo.noNeighbours())
+    {
+        rvo.computeNewVelocity();
+        command.velocity = rvo.getVelocity().cast<double>();
+    }
+
+    CS2_TRACEPOINT(agent_planned, (uint32_t)command.index, command.trace.sequence);
+}
+
+void common::swarm_planner::plan(std::vector<velocity_command> &commands)
+{
+    // every command owns its rvo agent and result, and only reads the 
+    // snapshot, hence the order the threads run them in does not matter
+    planning_pool->parallel_for(commands.size(),
+        [this, &commands](size_t i)
+        {
+            if (commands[i].plan)
+                conduct_planning(commands[i]);
+        });
+}
@@ -0,0 +1,291 @@
+/*
+* swarm_smoother.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "swarm_smoother.h"
+#include "common.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/GaussianBayesNet.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/LinearContainerFactor.h>
+#include <gtsam/slam/BetweenFactor.h>
+
+using gtsam::symbol_shorthand::L; // landmark (tag)
+
+common::swarm_smoother::swarm_smoother(size_t agents, size_t window, double sigma) :
+    window(std::max(window, (size_t)1)),
+    noise(gtsam::noiseModel::Diagonal::Sigmas(gtsam::Vector6::Constant(sigma))),
+    chains(agents)
+{
+}
+
+gtsam::Key common::swarm_smoother::state_key(size_t agent, size_t x) const
+{
+    // agent in the upper bits of the symbol index, its state in the lower
+    return gtsam::Symbol('x', ((uint64_t)agent << 32) | (uint64_t)x);
+}
+
+gtsam::ISAM2UpdateParams common::swarm_smoother::update_params() const
+{
+    gtsam::FastMap<gtsam::Key, int> constrained;
+    for (const auto &a : active)
+        constrained[L(a.first)] = 1;
+
+    gtsam::ISAM2UpdateParams params;
+    params.constrainedKeys = constrained;
+    return params;
+}
+
+void common::swarm_smoother::update(
+    const std::vector<std::pair<size_t, smoother_state>> &states)
+{
+    if (states.empty())
+        return;
+
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values initial;
+
+    for (const auto &[agent, state] : states)
+    {
+        chain &c = chains[agent];
+
+        entry e;
+        e.x = c.next_x++;
+        e.recorded = state.recorded;
+
+        gtsam::Key x = state_key(agent, e.x);
+        initial.insert(x, state.initial);
+
+        for (const auto &[l, measurement] : state.landmarks)
+        {
+            auto it = active.find(l->id);
+            // the first state to see a landmark brings its prior in
+            if (it == active.end())
+            {
+                it = active.insert({l->id, {l, 0}}).first;
+                graph.addPrior(L(l->id), l->prior, l->prior_noise);
+                initial.insert(L(l->id), l->prior);
+            }
+            it->second.second++;
+
+            // tag to body
+            e.factors.add(gtsam::BetweenFactor<gtsam::Pose3>(
+                x, L(l->id), measurement, noise));
+            e.landmark_ids.push_back(l->id);
+        }
+
+        // x(i-1) -> x(i)
+        if (c.has_previous)
+            e.odometry.add(gtsam::BetweenFactor<gtsam::Pose3>(
+                state_key(agent, e.x - 1), x,
+                c.previous_initial.inverse() * state.initial, noise));
+
+        c.previous_initial = state.initial;
+        c.has_previous = true;
+
+        graph.push_back(e.factors);
+        graph.push_back(e.odometry);
+        c.entries.push_back(std::move(e));
+    }
+
+    isam.update(graph, initial, update_params());
+
+    for (const chain &c : chains)
+    {
+        if (c.entries.size() >= 2 * window)
+        {
+            marginalize();
+            break;
+        }
+    }
+}
+
+void common::swarm_smoother::marginalize()
+{
+    gtsam::Values estimate = isam.calculateEstimate();
+
+    // states that see each landmark once the windows are cut
+    std::vector<size_t> drop(chains.size(), 0);
+    std::unordered_map<int, size_t> remaining;
+    for (const auto &[id, a] : active)
+        remaining[id] = a.second;
+
+    for (size_t a = 0; a < chains.size(); a++)
+    {
+        const chain &c = chains[a];
+        if (c.entries.size() <= window)
+            continue;
+        drop[a] = c.entries.size() - window;
+
+        for (size_t i = 0; i < drop[a]; i++)
+            for (int id : c.entries[i].landmark_ids)
+                remaining[id]--;
+    }
+
+    // the dropped states with the marginal before them. They are eliminated
+    // onto the newest dropped state of every chain and the landmarks that
+    // stay, whose priors go into the new graph and are left out here. The
+    // landmarks that leave are eliminated as well, with their priors
+    gtsam::NonlinearFactorGraph dropped_graph = anchor;
+    gtsam::KeySet separator;
+
+    for (size_t a = 0; a < chains.size(); a++)
+    {
+        const chain &c = chains[a];
+        if (drop[a] == 0)
+        {
+            if (c.has_anchor)
+                separator.insert(state_key(a, c.anchor_x));
+            continue;
+        }
+
+        for (size_t i = 0; i < drop[a]; i++)
+        {
+            dropped_graph.push_back(c.entries[i].factors);
+            dropped_graph.push_back(c.entries[i].odometry);
+        }
+        separator.insert(state_key(a, c.entries[drop[a] - 1].x));
+    }
+
+    for (const auto &[id, count] : remaining)
+    {
+        if (count > 0)
+        {
+            separator.insert(L(id));
+            continue;
+        }
+        const landmark *l = active.at(id).first;
+        dropped_graph.addPrior(L(id), l->prior, l->prior_noise);
+    }
+
+    gtsam::Values dropped_values;
+    gtsam::Ordering eliminated;
+    for (gtsam::Key key : dropped_graph.keys())
+    {
+        dropped_values.insert(key, estimate.at(key));
+        if (separator.find(key) == separator.end())
+            eliminated.push_back(key);
+    }
+
+    // what is left after the elimination is the joint marginal on the
+    // separator, kept linearized at the current estimate
+    auto marginal = dropped_graph.linearize(dropped_values)->
+        eliminatePartialSequential(eliminated).second;
+
+    anchor = gtsam::NonlinearFactorGraph();
+    for (const auto &factor : *marginal)
+    {
+        if (factor)
+            anchor.add(gtsam::LinearContainerFactor(factor, dropped_values));
+    }
+
+    for (size_t a = 0; a < chains.size(); a++)
+    {
+        if (drop[a] == 0)
+            continue;
+        chain &c = chains[a];
+
+        c.anchor_x = c.entries[drop[a] - 1].x;
+        c.has_anchor = true;
+
+        // landmarks no kept state sees leave the graph
+        for (size_t i = 0; i < drop[a]; i++)
+        {
+            for (int id : c.entries[i].landmark_ids)
+            {
+                auto it = active.find(id);
+                if (--it->second.second == 0)
+                    active.erase(it);
+            }
+        }
+
+        c.entries.erase(c.entries.begin(), c.entries.begin() + drop[a]);
+    }
+
+    // start over with the marginal and the states left in the windows
+    gtsam::NonlinearFactorGraph graph = anchor;
+    gtsam::Values values;
+
+    for (const auto &[id, a] : active)
+    {
+        graph.addPrior(L(id), a.first->prior, a.first->prior_noise);
+        values.insert(L(id), estimate.at<gtsam::Pose3>(L(id)));
+    }
+
+    for (size_t a = 0; a < chains.size(); a++)
+    {
+        const chain &c = chains[a];
+        if (c.has_anchor)
+        {
+            gtsam::Key anchor_key = state_key(a, c.anchor_x);
+            values.insert(anchor_key, estimate.at<gtsam::Pose3>(anchor_key));
+        }
+
+        for (const entry &e : c.entries)
+        {
+            graph.push_back(e.factors);
+            graph.push_back(e.odometry);
+            gtsam::Key x = state_key(a, e.x);
+            values.insert(x, estimate.at<gtsam::Pose3>(x));
+        }
+    }
+
+    isam = gtsam::ISAM2();
+    isam.update(graph, values, update_params());
+}
+
+bool common::swarm_smoother::correction(size_t agent,
+    Eigen::Vector3d &translation, Eigen::Quaterniond &rotation)
+{
+    chain &c = chains[agent];
+    std::vector<Eigen::Vector4f> quaternions_error_vector;
+    translation = Eigen::Vector3d::Zero();
+    rotation = Eigen::Quaterniond::Identity();
+
+    for (const entry &e : c.entries)
+    {
+        if (e.x < c.corrected_x)
+            continue;
+
+        gtsam::Pose3 opt_pose =
+            isam.calculateEstimate<gtsam::Pose3>(state_key(agent, e.x));
+        translation += Eigen::Vector3d(
+            opt_pose.x() - e.recorded.x(),
+            opt_pose.y() - e.recorded.y(),
+            opt_pose.z() - e.recorded.z());
+
+        Eigen::Quaterniond q_curr(e.recorded.rotation().matrix());
+        Eigen::Quaterniond q_opt(opt_pose.rotation().matrix());
+
+        // get the difference/error in quaternions
+        Eigen::Quaterniond q_diff = q_opt * q_curr.inverse();
+
+        quaternions_error_vector.emplace_back(quat_to_vec4(q_diff));
+    }
+
+    if (quaternions_error_vector.empty())
+        return false;
+    c.corrected_x = c.next_x;
+
+    translation /= (double)quaternions_error_vector.size();
+    rotation = vec4_to_quat(quaternion_average(quaternions_error_vector));
+    return true;
+}
@@ -37,6 +37,7 @@
 #include <tf2_ros/transform_broadcaster.h>
 
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
 
 #include "common.h"
 
@@ -63,6 +64,7 @@ class RvizVisualizer : public rclcpp::Node
         rclcpp::Clock clock;
 
         rclcpp::Publisher<MarkerArray>::SharedPtr tag_publisher;
+        rclcpp::Publisher<MarkerArray>::SharedPtr obstacle_publisher;
         rclcpp::Publisher<OverlayText>::SharedPtr text_publisher;
 
         rclcpp::Subscription<AgentsStateFeedback>::SharedPtr agent_state_subscriber;
@@ -71,6 +73,8 @@ class RvizVisualizer : public rclcpp::Node
 
         std::map<std::string, tag> april_tags;
 
+        std::map<std::string, obstacle> obstacles;
+
         std::string mesh_path;
 
         double scale_factor;
@@ -87,11 +91,10 @@ class RvizVisualizer : public rclcpp::Node
         }
 
         void agents_state_callback(
-            const AgentsStateFeedback::SharedPtr msg)
+            const AgentsStateFeedback &msg)
         {
             rclcpp::Time now = clock.now();
 
-            AgentsStateFeedback copy = *msg;
             OverlayText text_msg;
             text_msg.action = OverlayText::ADD;
             text_msg.horizontal_alignment = OverlayText::LEFT;
@@ -109,7 +112,7 @@ class RvizVisualizer : public rclcpp::Node
             std::map<int, agent_state> agents_map;
 
             // copy agent messages into local states
-            for (auto &agent : copy.agents)
+            for (const auto &agent : msg.agents)
             {
                 std::string str_copy = agent.id;
                 // Remove cf from cfXX
@@ -235,17 +238,57 @@ class RvizVisualizer : public rclcpp::Node
 
         void show_obstacles_tag()
         {
-            
+            std::string frame = "/world";
+            double thickness = 0.05;
+            MarkerArray obstacle_array;
+            for (auto &[name, obs] : obstacles)
+            {
+                // one box per wall of the polyline
+                for (size_t i = 0; i + 1 < obs.points.size(); i++)
+                {
+                    Eigen::Vector2d start = obs.points[i];
+                    Eigen::Vector2d end = obs.points[i+1];
+                    Eigen::Vector2d center = (start + end) / 2.0;
+                    Eigen::Vector2d direction = end - start;
+                    double yaw = std::atan2(direction.y(), direction.x());
+
+                    Marker mk;
+                    mk.header.frame_id = frame;
+                    mk.header.stamp = clock.now();
+                    mk.ns = name;
+                    mk.id = (int)i;
+                    mk.type = visualization_msgs::msg::Marker::CUBE;
+                    mk.action = visualization_msgs::msg::Marker::ADD;
+                    mk.pose.position.x = center.x();
+                    mk.pose.position.y = center.y();
+                    mk.pose.position.z = (obs.height.first + obs.height.second) / 2.0;
+                    mk.pose.orientation.x = 0.0;
+                    mk.pose.orientation.y = 0.0;
+                    mk.pose.orientation.z = std::sin(yaw / 2.0);
+                    mk.pose.orientation.w = std::cos(yaw / 2.0);
+                    mk.scale.x = direction.norm() + thickness;
+                    mk.scale.y = thickness;
+                    mk.scale.z = obs.height.second - obs.height.first;
+                    mk.color.r = mk.color.g = mk.color.b = 0.6f;
+                    mk.color.a = 0.5;
+
+                    obstacle_array.markers.push_back(mk);
+                }
+            }
+
+            obstacle_publisher->publish(obstacle_array);
         }
 
     public:
 
-        RvizVisualizer()
-        : Node("rviz_visualizer"), clock(RCL_ROS_TIME), tf2_bc(this)
+        explicit RvizVisualizer(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("rviz_visualizer", options), clock(RCL_ROS_TIME), tf2_bc(this)
         {
 
             tag_publisher = this->create_publisher<MarkerArray>("rviz/tag", 10);
 
+            obstacle_publisher = this->create_publisher<MarkerArray>("rviz/obstacles", 10);
+
             text_publisher = this->create_publisher<OverlayText>("rviz/text", 10);
             
             visualizing_timer = this->create_wall_timer(
@@ -336,11 +379,10 @@ class RvizVisualizer : public rclcpp::Node
                 }
             }
 
-            auto obstacles = extract_names(parameter_overrides, "environment.obstacles");
-            for (const auto &obs : obstacles) 
-            {
-                
-            }
+            obstacles = load_obstacles(parameter_overrides);
+            for (const auto &[name, obs] : obstacles) 
+                RCLCPP_INFO(this->get_logger(), "obstacle %s: %s with %zu points", 
+                    name.c_str(), obs.type.c_str(), obs.points.size());
 
             agent_state_subscriber = 
                 this->create_subscription<AgentsStateFeedback>("agents",
@@ -356,10 +398,4 @@ class RvizVisualizer : public rclcpp::Node
         }        
 };
 
-int main(int argc, char * argv[])
-{
-    rclcpp::init(argc, argv);
-    rclcpp::spin(std::make_shared<RvizVisualizer>());
-    rclcpp::shutdown();
-    return 0;
-}
\ No newline at end of file
+RCLCPP_COMPONENTS_REGISTER_NODE(RvizVisualizer)
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+* worker_pool.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include "worker_pool.h"
+
+common::worker_pool::worker_pool(size_t thread_count)
+{
+    // the calling thread is the first worker
+    for (size_t i = 1; i < thread_count; i++)
+        workers.emplace_back(&worker_pool::worker_loop, this);
+}
+
+common::worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    start_cv.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void common::worker_pool::run_job()
+{
+    for (size_t i = next.fetch_add(1); i < job_size; i = next.fetch_add(1))
+        job(i);
+}
+
+void common::worker_pool::worker_loop()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        start_cv.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+            return;
+        seen = generation;
+
+        lock.unlock();
+        run_job();
+        lock.lock();
+
+        if (--pending == 0)
+            done_cv.notify_one();
+    }
+}
@@ -0,0 +1,140 @@
+/*
+* test_orca_planes.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include "orca_planes.h"
+
+namespace
+{
+    const float time_horizon = 2.0f;
+    const float time_step = 0.125f;
+    const float own_radius = 0.15f;
+
+    void push_neighbour(RVO::NeighborBuffer &neighbours, size_t i,
+        const Eigen::Vector3f &p, const Eigen::Vector3f &v, float radius)
+    {
+        neighbours.px[i] = p.x(); neighbours.py[i] = p.y(); neighbours.pz[i] = p.z();
+        neighbours.vx[i] = v.x(); neighbours.vy[i] = v.y(); neighbours.vz[i] = v.z();
+        neighbours.radius[i] = radius;
+    }
+
+    void expect_near(float simd, float scalar, size_t i, const char *field)
+    {
+        // a degenerate pair has no plane on either path
+        if (std::isnan(scalar))
+        {
+            EXPECT_TRUE(std::isnan(simd)) << field << " of neighbour " << i;
+            return;
+        }
+        EXPECT_NEAR(simd, scalar, 1e-3f * std::max(1.0f, std::abs(scalar)))
+            << field << " of neighbour " << i;
+    }
+
+    void expect_same_planes(const RVO::NeighborBuffer &neighbours,
+        const Eigen::Vector3f &position, const Eigen::Vector3f &velocity)
+    {
+        RVO::PlaneBuffer simd, scalar;
+        RVO::buildOrcaPlanes(neighbours, position, velocity, own_radius,
+            time_horizon, time_step, simd);
+        RVO::buildOrcaPlanesScalar(neighbours, position, velocity, own_radius,
+            time_horizon, time_step, scalar);
+
+        for (size_t i = 0; i < neighbours.size; i++)
+        {
+            expect_near(simd.nx[i], scalar.nx[i], i, "nx");
+            expect_near(simd.ny[i], scalar.ny[i], i, "ny");
+            expect_near(simd.nz[i], scalar.nz[i], i, "nz");
+            expect_near(simd.px[i], scalar.px[i], i, "px");
+            expect_near(simd.py[i], scalar.py[i], i, "py");
+            expect_near(simd.pz[i], scalar.pz[i], i, "pz");
+        }
+    }
+}
+
+TEST(orca_planes, random_neighbours_match_scalar)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> radius(0.05f, 0.3f);
+
+    // counts on both sides of every multiple of the lane width, the padding
+    // of the tail must not leak into the planes of the real neighbours
+    for (size_t count = 0; count <= 3 * RVO::RVO3D_ORCA_LANES + 1; count++)
+    {
+        for (int trial = 0; trial < 20; trial++)
+        {
+            Eigen::Vector3f p(position(rng), position(rng), position(rng));
+            Eigen::Vector3f v(velocity(rng), velocity(rng), velocity(rng));
+
+            RVO::NeighborBuffer neighbours;
+            neighbours.resize(count);
+            for (size_t i = 0; i < count; i++)
+                push_neighbour(neighbours, i,
+                    Eigen::Vector3f(position(rng), position(rng), position(rng)),
+                    Eigen::Vector3f(velocity(rng), velocity(rng), velocity(rng)),
+                    radius(rng));
+
+            expect_same_planes(neighbours, p, v);
+        }
+    }
+}
+
+TEST(orca_planes, colliding_and_degenerate_pairs_match_scalar)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> offset(-0.2f, 0.2f);
+    std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+
+    const Eigen::Vector3f p(0.5f, -0.25f, 1.0f);
+    const Eigen::Vector3f v(0.3f, 0.1f, 0.0f);
+
+    // a count that is not a multiple of the lane width
+    const size_t count = 2 * RVO::RVO3D_ORCA_LANES + 3;
+    RVO::NeighborBuffer neighbours;
+    neighbours.resize(count);
+
+    size_t i = 0;
+    // overlapping, the collision plane
+    for (; i < RVO::RVO3D_ORCA_LANES; i++)
+        push_neighbour(neighbours, i,
+            p + Eigen::Vector3f(offset(rng), offset(rng), offset(rng)),
+            Eigen::Vector3f(velocity(rng), velocity(rng), velocity(rng)), 0.15f);
+    // on top of the agent, with and without a relative velocity
+    push_neighbour(neighbours, i++, p, Eigen::Vector3f::Zero(), 0.15f);
+    push_neighbour(neighbours, i++, p, v, 0.15f);
+    // just outside the combined radius, the cone is close to a half space
+    push_neighbour(neighbours, i++, p + Eigen::Vector3f(0.31f, 0.0f, 0.0f), 
+        Eigen::Vector3f(-0.3f, 0.0f, 0.0f), 0.15f);
+    // no relative velocity, on the cut-off circle
+    push_neighbour(neighbours, i++, p + Eigen::Vector3f(1.0f, 1.0f, 0.0f), v, 0.15f);
+    // head on, the relative velocity along the relative position
+    push_neighbour(neighbours, i++, p + Eigen::Vector3f(2.0f, 0.0f, 0.0f), 
+        Eigen::Vector3f(-1.0f, 0.0f, 0.0f), 0.15f);
+    for (; i < count; i++)
+        push_neighbour(neighbours, i,
+            p + Eigen::Vector3f(1.0f + offset(rng), offset(rng), offset(rng)),
+            Eigen::Vector3f(velocity(rng), velocity(rng), velocity(rng)), 0.15f);
+
+    expect_same_planes(neighbours, p, v);
+}
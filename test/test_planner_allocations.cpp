@@ -0,0 +1,146 @@
+/*
+* test_planner_allocations.cpp
+*
+* ---------------------------------------------------------------------
+* Copyright (C) 2023 Matthew (matthewoots at gmail.com)
+*
+*  This program is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU General Public License
+*  as published by the Free Software Foundation; either version 2
+*  of the License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+* ---------------------------------------------------------------------
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "headless_sim.h"
+
+using namespace common;
+
+namespace
+{
+    // allocations from any thread while counting is on
+    std::atomic<bool> counting{false};
+    std::atomic<size_t> allocations{0};
+
+    void *counted_allocation(std::size_t size, std::size_t alignment) noexcept
+    {
+        if (counting.load(std::memory_order_relaxed))
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        if (alignment <= alignof(std::max_align_t))
+            return std::malloc(size);
+        // aligned_alloc wants a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    void *counted_or_throw(std::size_t size, std::size_t alignment)
+    {
+        if (void *p = counted_allocation(size, alignment))
+            return p;
+        throw std::bad_alloc();
+    }
+}
+
+// every replaceable form, so that none of the planner's allocations is
+// missed and each delete matches its new
+void *operator new(std::size_t size)
+{
+    return counted_or_throw(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size)
+{
+    return counted_or_throw(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_or_throw(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return counted_or_throw(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, 
+    const std::nothrow_t &) noexcept
+{
+    return counted_allocation(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, 
+    const std::nothrow_t &) noexcept
+{
+    return counted_allocation(size, (std::size_t)alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { std::free(p); }
+
+namespace
+{
+    /** @brief allocations of the planning ticks after the first ones **/
+    size_t steady_state_allocations(sim_scenario scenario, size_t threads)
+    {
+        sim_config config;
+        config.scenario = scenario;
+        config.agents = 50;
+        config.planner.threads = threads;
+
+        headless_sim sim(config);
+        // the first ticks grow the pools up to the crowd they see
+        for (int i = 0; i < 20; i++)
+            sim.step();
+
+        allocations = 0;
+        counting = true;
+        for (int i = 0; i < 100; i++)
+            sim.step();
+        counting = false;
+
+        return allocations;
+    }
+}
+
+TEST(planner_allocations, steady_state_ticks_do_not_allocate)
+{
+    for (sim_scenario scenario : {CIRCLE_SWAP, CORRIDOR, RANDOM_GOALS})
+        for (size_t threads : {1, 4})
+            EXPECT_EQ(steady_state_allocations(scenario, threads), 0u)
+                << headless_sim::scenario_name(scenario) << " on " 
+                << threads << " threads";
+}